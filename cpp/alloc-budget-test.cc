@@ -0,0 +1,113 @@
+// Holds the hot paths at 1k players to their allocation budgets (see
+// alloc-budget.h).
+
+#include "cpp/alloc-budget.h"
+
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "cpp/impl/round.h"
+#include "cpp/impl/tournament.h"
+#include "cpp/pairings/isomorphism.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+
+constexpr uint64_t kPlayers = 1000;
+
+class AllocBudgetTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TournamentImpl::Options opts;
+    opts.swiss_rounds = 3;
+    tournament_ = std::make_shared<TournamentImpl>(opts);
+    tournament_->Init();
+    for (uint64_t id = 1; id <= kPlayers; ++id) {
+      ASSERT_TRUE(tournament_
+                      ->AddPlayer({id, "First", absl::StrCat("Last", id), ""})
+                      .ok());
+    }
+    auto round = tournament_->PairNextRound();
+    ASSERT_TRUE(round.ok()) << round.status();
+    round_ = *std::move(round);
+  }
+
+  std::shared_ptr<TournamentImpl> tournament_;
+  std::optional<Round> round_;
+};
+
+MatchResult WinFor(const Match& m) {
+  return MatchResult{m->id(), m->player_a()->id(), 2, 1};
+}
+
+TEST_F(AllocBudgetTest, ReportResult) {
+  const std::vector<Match> matches = (*round_)->OutstandingMatches();
+  ASSERT_FALSE(matches.empty());
+
+  // A first report only records it on the match.
+  for (const Match& m : matches) {
+    absl::Status status;
+    auto budget = CheckAllocations("ReportResult (first report)", {0}, [&]() {
+      status = tournament_->ReportResult(m->player_a()->id(), WinFor(m));
+    });
+    EXPECT_TRUE(budget.ok()) << budget;
+    EXPECT_TRUE(status.ok()) << status;
+  }
+
+  // Confirming a result commits it to the round, whose maps are sized when it
+  // is paired, and moves both players into the score group for their new
+  // points. Those groups grow geometrically, so confirming the whole round
+  // costs O(log players) allocations for each group, not one per result.
+  // Measured at 11; the slack is for a group crossing another doubling under a
+  // different pairing, while one allocation per result would still blow it.
+  absl::Status status;
+  auto budget = CheckAllocations("ReportResult (confirm a round)", {16}, [&]() {
+    for (const Match& m : matches) {
+      auto out = tournament_->ReportResult((*m->player_b())->id(), WinFor(m));
+      if (status.ok()) status = out;
+    }
+  });
+  EXPECT_TRUE(budget.ok()) << budget;
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST_F(AllocBudgetTest, FindMatch) {
+  for (uint64_t id = 1; id <= kPlayers; ++id) {
+    bool found = false;
+    auto budget = CheckAllocations("FindMatch", {0}, [&]() {
+      found = tournament_->FindMatch(id).ok();
+    });
+    EXPECT_TRUE(budget.ok()) << budget;
+    EXPECT_TRUE(found) << id;
+  }
+}
+
+TEST_F(AllocBudgetTest, PairChunk) {
+  std::vector<Player> players;
+  players.reserve(kPlayers);
+  for (uint64_t id = 1; id <= kPlayers; ++id) {
+    auto p = tournament_->GetPlayer(id);
+    ASSERT_TRUE(p.ok()) << p.status();
+    players.push_back(*std::move(p));
+  }
+
+  // The graph and the pairing returned are a fixed number of buffers, each
+  // linear in the players, so neither count may grow with the chunk's edges.
+  std::mt19937_64 rand(1);
+  PartialPairing pairing;
+  auto budget = CheckAllocations("PairChunk (1k players)", {16, 64 << 10},
+                                 [&]() { pairing = PairChunk(players, rand); });
+  EXPECT_TRUE(budget.ok()) << budget;
+  EXPECT_EQ(pairing.paired.size() * 2 + pairing.unpaired.size(), kPlayers);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tcgtc
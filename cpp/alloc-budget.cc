@@ -0,0 +1,135 @@
+#include "cpp/alloc-budget.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+
+namespace tcgtc {
+namespace {
+// Constant-initialized, so that touching them never allocates.
+thread_local uint64_t allocations = 0;
+thread_local uint64_t bytes = 0;
+
+void* Allocate(size_t size, std::nothrow_t) noexcept {
+  ++allocations;
+  bytes += size;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* Allocate(size_t size) {
+  if (void* p = Allocate(size, std::nothrow); p != nullptr) return p;
+  throw std::bad_alloc();
+}
+
+void* AllocateAligned(size_t size, std::align_val_t align,
+                      std::nothrow_t) noexcept {
+  ++allocations;
+  bytes += size;
+  const size_t alignment = static_cast<size_t>(align);
+#ifdef _WIN32
+  return _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+  // aligned_alloc needs a size that is a multiple of the alignment.
+  const size_t rounded = (size + alignment - 1) / alignment * alignment;
+  return std::aligned_alloc(alignment, rounded == 0 ? alignment : rounded);
+#endif
+}
+
+void* AllocateAligned(size_t size, std::align_val_t align) {
+  if (void* p = AllocateAligned(size, align, std::nothrow); p != nullptr) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void FreeAligned(void* p) noexcept {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+}  // namespace
+
+AllocationStats ThreadAllocations() { return {allocations, bytes}; }
+
+absl::Status CheckAllocations(absl::string_view what,
+                              const AllocationBudget& budget,
+                              absl::FunctionRef<void()> fn) {
+  AllocationStats used;
+  {
+    AllocationScope scope;
+    fn();
+    used = scope.stats();
+  }
+  if (used.allocations <= budget.max_allocations &&
+      used.bytes <= budget.max_bytes) {
+    return absl::OkStatus();
+  }
+  std::string limit = absl::StrCat(budget.max_allocations);
+  if (budget.max_bytes != std::numeric_limits<uint64_t>::max()) {
+    absl::StrAppend(&limit, " (", budget.max_bytes, " bytes)");
+  }
+  return absl::ResourceExhaustedError(
+      absl::StrCat(what, " made ", used.allocations, " allocations (",
+                   used.bytes, " bytes); the budget is ", limit, "."));
+}
+
+}  // namespace tcgtc
+
+// The replaceable global allocation functions. The unsized, array and nothrow
+// forms of delete all free the same way.
+void* operator new(size_t size) { return tcgtc::Allocate(size); }
+void* operator new[](size_t size) { return tcgtc::Allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return tcgtc::Allocate(size, std::nothrow);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return tcgtc::Allocate(size, std::nothrow);
+}
+void* operator new(size_t size, std::align_val_t align) {
+  return tcgtc::AllocateAligned(size, align);
+}
+void* operator new[](size_t size, std::align_val_t align) {
+  return tcgtc::AllocateAligned(size, align);
+}
+void* operator new(size_t size, std::align_val_t align,
+                   const std::nothrow_t&) noexcept {
+  return tcgtc::AllocateAligned(size, align, std::nothrow);
+}
+void* operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t&) noexcept {
+  return tcgtc::AllocateAligned(size, align, std::nothrow);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+  tcgtc::FreeAligned(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+  tcgtc::FreeAligned(p);
+}
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  tcgtc::FreeAligned(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+  tcgtc::FreeAligned(p);
+}
+void operator delete(void* p, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  tcgtc::FreeAligned(p);
+}
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  tcgtc::FreeAligned(p);
+}
@@ -0,0 +1,69 @@
+// Counts the heap allocations made on the calling thread, so that hot
+// operations can be held to an allocation budget and a regression fails a test
+// or benchmark rather than showing up in production, e.g.
+//
+//   auto out = CheckAllocations("ReportResult (success)", {0}, [&]() {
+//     status = tournament->ReportResult(player, result);
+//   });
+//
+//   auto out = CheckAllocations("PairChunk (1k players)", {4000, 1 << 20},
+//                               [&]() { PairChunk(players, may_pair, rand); });
+//
+// Linking this library replaces the global operator new and delete (which count
+// into a thread-local, then defer to malloc), so only link it into test and
+// benchmark binaries. Work an operation hands to other threads (e.g. to an
+// Executor) is not counted against it.
+
+#ifndef _TCGTC_ALLOC_BUDGET_H_
+#define _TCGTC_ALLOC_BUDGET_H_
+
+#include <cstdint>
+#include <limits>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace tcgtc {
+
+struct AllocationStats {
+  uint64_t allocations = 0;
+  // As requested, i.e. not counting the allocator's own overhead.
+  uint64_t bytes = 0;
+};
+
+struct AllocationBudget {
+  uint64_t max_allocations = 0;
+  uint64_t max_bytes = std::numeric_limits<uint64_t>::max();
+};
+
+// Everything allocated on the calling thread since the thread started.
+AllocationStats ThreadAllocations();
+
+// Counts what the calling thread allocates while it is alive. Scopes may nest.
+class AllocationScope {
+ public:
+  AllocationScope() : start_(ThreadAllocations()) {}
+
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+
+  // Since construction.
+  AllocationStats stats() const {
+    const AllocationStats now = ThreadAllocations();
+    return {now.allocations - start_.allocations, now.bytes - start_.bytes};
+  }
+
+ private:
+  const AllocationStats start_;
+};
+
+// Runs `fn`, and returns an error naming `what` and its actual allocations if
+// it allocated more than `budget` on this thread.
+absl::Status CheckAllocations(absl::string_view what,
+                              const AllocationBudget& budget,
+                              absl::FunctionRef<void()> fn);
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_ALLOC_BUDGET_H_
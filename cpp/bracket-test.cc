@@ -0,0 +1,101 @@
+// Holds elimination results to the bracket: once the next round has been
+// paired from a match's winner, that winner can no longer change.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "cpp/impl/bracket.h"
+#include "cpp/impl/round.h"
+#include "cpp/impl/tournament.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+
+MatchResult WinFor(const Match& m, const Player& winner) {
+  return MatchResult{m->id(), winner->id(), 2, 0};
+}
+
+// Judges a win for player A in every outstanding match of the current round.
+void FinishRound(TournamentImpl& t) {
+  auto round = t.CurrentRound();
+  ASSERT_TRUE(round.ok()) << round.status();
+  for (const Match& m : (*round)->OutstandingMatches()) {
+    auto out = t.JudgeSetResult(WinFor(m, m->player_a()));
+    ASSERT_TRUE(out.ok()) << out;
+  }
+}
+
+class BracketTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TournamentImpl::Options opts;
+    opts.swiss_rounds = 2;
+    opts.bracket = BracketSize::kTop4;
+    tournament_ = std::make_shared<TournamentImpl>(opts);
+    tournament_->Init();
+    for (uint64_t id = 1; id <= 8; ++id) {
+      ASSERT_TRUE(tournament_
+                      ->AddPlayer({id, "First", absl::StrCat("Last", id), ""})
+                      .ok());
+    }
+    for (int swiss = 0; swiss < 2; ++swiss) {
+      ASSERT_TRUE(tournament_->PairNextRound().ok());
+      FinishRound(*tournament_);
+    }
+    // The semi-finals.
+    auto semis = tournament_->PairNextRound();
+    ASSERT_TRUE(semis.ok()) << semis.status();
+    semis_ = (*semis)->OutstandingMatches();
+    ASSERT_EQ(semis_.size(), 2);
+    FinishRound(*tournament_);
+  }
+
+  std::shared_ptr<TournamentImpl> tournament_;
+  std::vector<Match> semis_;
+};
+
+TEST_F(BracketTest, FixBeforeNextRoundIsPaired) {
+  const Match& semi = semis_[0];
+  auto out = tournament_->JudgeSetResult(WinFor(semi, *semi->player_b()));
+  EXPECT_TRUE(out.ok()) << out;
+
+  auto final = tournament_->PairNextRound();
+  ASSERT_TRUE(final.ok()) << final.status();
+  const auto matches = (*final)->OutstandingMatches();
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_TRUE(matches[0]->has_player(*semi->player_b()));
+}
+
+TEST_F(BracketTest, NoFixOnceNextRoundIsPaired) {
+  auto final = tournament_->PairNextRound();
+  ASSERT_TRUE(final.ok()) << final.status();
+
+  // The winner is already playing in the final.
+  const Match& semi = semis_[0];
+  auto out = tournament_->JudgeSetResult(WinFor(semi, *semi->player_b()));
+  EXPECT_FALSE(out.ok());
+  out = tournament_->ReportResult((*semi->player_b())->id(),
+                                  WinFor(semi, *semi->player_b()));
+  EXPECT_FALSE(out.ok());
+
+  // Fixing the score, but not the winner, still goes through.
+  out = tournament_->JudgeSetResult(
+      MatchResult{semi->id(), semi->player_a()->id(), 2, 1});
+  EXPECT_TRUE(out.ok()) << out;
+
+  // And the final plays out as paired.
+  const auto matches = (*final)->OutstandingMatches();
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_TRUE(matches[0]->has_player(semi->player_a()));
+  out = tournament_->JudgeSetResult(WinFor(matches[0], semi->player_a()));
+  EXPECT_TRUE(out.ok()) << out;
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tcgtc
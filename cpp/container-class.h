@@ -36,7 +36,7 @@ class ContainerClass {
 
   ContainerClass() = delete;
   explicit ContainerClass(std::shared_ptr<Impl> impl) : impl_(std::move(impl)) {
-    assert(impl != nullptr);
+    assert(impl_ != nullptr);
   }
  private:
   std::shared_ptr<Impl> impl_;
@@ -0,0 +1,113 @@
+#include "cpp/event-feed.h"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace tcgtc {
+namespace {
+size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t out = 1;
+  while (out < n) out <<= 1;
+  return out;
+}
+}  // namespace
+
+// EventFeed -------------------------------------------------------------------
+EventFeed::EventFeed(size_t capacity, uint64_t first_seq)
+  : first_(std::max<uint64_t>(first_seq, 1)), next_(first_ - 1),
+    mask_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1),
+    slots_(mask_ + 1) {}
+
+uint64_t EventFeed::Publish(TournamentEvent event) {
+  const uint64_t seq = next_.fetch_add(1, std::memory_order_acq_rel) + 1;
+  event.seq = seq;
+
+  uint64_t buf[kWords] = {};
+  std::memcpy(buf, &event, sizeof(event));
+
+  // The slot holds the event one lap earlier, or nothing on the first lap.
+  // Claiming it only from that event means two writers never fill it at once,
+  // which a reader's stamp checks could not tell from a whole event.
+  Slot& slot = slots_[seq & mask_];
+  const uint64_t lap = slots_.size();
+  const uint64_t prev = seq - first_ >= lap ? seq - lap : 0;
+  uint64_t expected = prev;
+  while (!slot.stamp.compare_exchange_weak(expected, kBusy,
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+    expected = prev;
+    std::this_thread::yield();
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < kWords; ++i) {
+    slot.words[i].store(buf[i], std::memory_order_relaxed);
+  }
+  slot.stamp.store(seq, std::memory_order_release);
+  return seq;
+}
+
+uint64_t EventFeed::oldest_seq() const {
+  const uint64_t last = next_.load(std::memory_order_acquire);
+  return std::max(first_, last < slots_.size() ? 1 : last - slots_.size() + 1);
+}
+
+EventFeed::ReadResult EventFeed::Read(uint64_t seq, TournamentEvent& out) const {
+  // Published before this feed took over, so never in the ring.
+  if (seq < first_) return ReadResult::kOverwritten;
+  const Slot& slot = slots_[seq & mask_];
+  const uint64_t before = slot.stamp.load(std::memory_order_acquire);
+  if (before == kBusy || before < seq) {
+    // Either still being written, or a writer has claimed `seq` but not yet
+    // published it. If a lapping writer holds the slot we find out next time.
+    return before == kBusy && oldest_seq() > seq ? ReadResult::kOverwritten
+                                                 : ReadResult::kNotReady;
+  }
+  if (before > seq) return ReadResult::kOverwritten;
+
+  uint64_t buf[kWords];
+  for (size_t i = 0; i < kWords; ++i) {
+    buf[i] = slot.words[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.stamp.load(std::memory_order_relaxed) != before) {
+    return ReadResult::kOverwritten;
+  }
+  std::memcpy(&out, buf, sizeof(out));
+  assert(out.seq == seq);
+  return ReadResult::kOk;
+}
+
+// Subscriber ------------------------------------------------------------------
+EventFeed::Subscriber::Subscriber(std::shared_ptr<const EventFeed> feed,
+                                  std::optional<uint64_t> from_seq)
+  : feed_(std::move(feed)),
+    cursor_(from_seq.has_value() ? std::max<uint64_t>(*from_seq, 1)
+                                 : feed_->next_seq()) {}
+
+EventFeed::Batch EventFeed::Subscriber::Poll(size_t max_events) {
+  Batch out;
+  const uint64_t end = feed_->next_seq();
+  while (out.events.size() < max_events && cursor_ < end) {
+    TournamentEvent event;
+    switch (feed_->Read(cursor_, event)) {
+      case ReadResult::kOk:
+        out.events.push_back(event);
+        ++cursor_;
+        break;
+      case ReadResult::kNotReady:
+        // Preserve ordering: never skip past an event still being published.
+        return out;
+      case ReadResult::kOverwritten: {
+        // We were lapped; skip ahead to the oldest event still retained.
+        uint64_t oldest = std::max(feed_->oldest_seq(), cursor_ + 1);
+        out.missed += oldest - cursor_;
+        cursor_ = oldest;
+        break;
+      }
+    }
+  }
+  return out;
+}
+
+}  // namespace tcgtc
@@ -0,0 +1,129 @@
+// This file defines a change-data feed of tournament events. Producers (e.g.
+// ReportResult) publish into a fixed-size ring buffer without ever taking a
+// lock, and any number of subscribers read from it at their own pace.
+//
+// A subscriber is only a cursor into the ring, so memory per subscriber is
+// constant. A subscriber which falls more than a full ring behind is told how
+// many events it missed, and should resync from e.g. GetStandings.
+
+#ifndef _TCGTC_EVENT_FEED_H_
+#define _TCGTC_EVENT_FEED_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "cpp/match-id.h"
+#include "cpp/match-result.h"
+#include "cpp/memory-usage.h"
+
+namespace tcgtc {
+
+enum class EventType : uint8_t {
+  kMatchReported = 0,
+  kResultConfirmed,
+  kResultConflict,
+  kJudgeOverride,
+  kRoundPaired,
+  kStandingsPublished,
+  // The round's previous pairings (and their results) were discarded, and it
+  // was paired again.
+  kRoundRepaired,
+  kPlayerAdded,
+  kPlayerDropped,
+};
+
+struct TournamentEvent {
+  // Assigned by the feed on publish. Strictly increasing, starting at 1.
+  uint64_t seq = 0;
+  EventType type = EventType::kMatchReported;
+  RoundId round = 0;
+  MatchId match = {0, 0};
+  // The reporting player, for kMatchReported, or the player added or dropped.
+  PlayerId player = 0;
+  std::optional<MatchResult> result;
+};
+
+class EventFeed {
+ public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  // The capacity is rounded up to a power of two, and should be larger than
+  // the number of threads which may publish concurrently (see Publish). A feed
+  // carrying on from an earlier one (e.g. of a reloaded tournament) starts at
+  // `first_seq`, and reads of anything older are reported as missed.
+  explicit EventFeed(size_t capacity = kDefaultCapacity,
+                     uint64_t first_seq = 1);
+
+  // Returns the sequence number assigned to the event. Never blocks, unless a
+  // full ring of publishes is in flight at once: a writer which laps another
+  // still filling the same slot waits for it to finish.
+  uint64_t Publish(TournamentEvent event);
+
+  // The sequence number the next published event will receive.
+  uint64_t next_seq() const {
+    return next_.load(std::memory_order_acquire) + 1;
+  }
+  // The oldest sequence number which may still be read from the ring.
+  uint64_t oldest_seq() const;
+  size_t capacity() const { return slots_.size(); }
+  // The ring, in bytes (see cpp/memory-usage.h).
+  size_t BytesUsed() const { return HeapBytes(slots_); }
+
+  struct Batch {
+    // Number of events which were overwritten before they could be read.
+    uint64_t missed = 0;
+    std::vector<TournamentEvent> events;
+  };
+
+  class Subscriber {
+   public:
+    // Resumes from `from_seq`, or only sees new events if unset.
+    Subscriber(std::shared_ptr<const EventFeed> feed,
+               std::optional<uint64_t> from_seq);
+
+    // Returns up to `max_events` events, in sequence order, without blocking.
+    Batch Poll(size_t max_events);
+
+    // The sequence number of the next event this subscriber will read.
+    uint64_t cursor() const { return cursor_; }
+
+   private:
+    std::shared_ptr<const EventFeed> feed_;
+    uint64_t cursor_;
+  };
+
+ private:
+  static constexpr uint64_t kBusy = ~uint64_t{0};
+  static constexpr size_t kWords =
+      (sizeof(TournamentEvent) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  static_assert(std::is_trivially_copyable_v<TournamentEvent>,
+                "Events are copied word-wise in and out of the ring.");
+
+  // A seqlock protected slot. The payload is stored as atomic words so that a
+  // reader racing with a (lapping) writer is well defined; the reader detects
+  // the race via the stamp and discards what it read.
+  struct Slot {
+    // The seq of the event held, 0 if empty, or kBusy while being written.
+    std::atomic<uint64_t> stamp{0};
+    std::array<std::atomic<uint64_t>, kWords> words;
+  };
+
+  enum class ReadResult { kOk, kNotReady, kOverwritten };
+  ReadResult Read(uint64_t seq, TournamentEvent& out) const;
+
+  const uint64_t first_;
+  // Sequence number of the last claimed event.
+  std::atomic<uint64_t> next_;
+  const uint64_t mask_;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_EVENT_FEED_H_
@@ -0,0 +1,55 @@
+#include "cpp/executor.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace tcgtc {
+
+Executor::Executor(size_t num_threads) {
+  threads_.reserve(std::max<size_t>(num_threads, 1));
+  for (size_t i = 0; i < std::max<size_t>(num_threads, 1); ++i) {
+    threads_.emplace_back([this]() { Work(); });
+  }
+}
+
+Executor::~Executor() {
+  {
+    absl::MutexLock l(&mu_);
+    stopping_ = true;
+  }
+  for (auto& t : threads_) {
+    // Destroying the executor from one of its own tasks would deadlock.
+    assert(t.get_id() != std::this_thread::get_id());
+    t.join();
+  }
+}
+
+void Executor::Schedule(std::function<void()> fn) {
+  absl::MutexLock l(&mu_);
+  assert(!stopping_);
+  queue_.push_back(std::move(fn));
+}
+
+size_t Executor::pending() const {
+  absl::MutexLock l(&mu_);
+  return queue_.size();
+}
+
+void Executor::Work() {
+  auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stopping_ || !queue_.empty();
+  };
+  while (true) {
+    std::function<void()> fn;
+    {
+      absl::MutexLock l(&mu_);
+      mu_.Await(absl::Condition(&has_work));
+      if (queue_.empty()) return;  // Stopping, and fully drained.
+      fn = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    fn();
+  }
+}
+
+}  // namespace tcgtc
@@ -0,0 +1,46 @@
+// A minimal fixed-size thread pool, for work we want off of the request path
+// (e.g. speculative pairings, standings generation).
+
+#ifndef _TCGTC_EXECUTOR_H_
+#define _TCGTC_EXECUTOR_H_
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tcgtc {
+
+class Executor {
+ public:
+  explicit Executor(size_t num_threads);
+
+  // Runs all scheduled work, then joins the worker threads.
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  void Schedule(std::function<void()> fn) ABSL_LOCKS_EXCLUDED(mu_);
+
+  size_t num_threads() const { return threads_.size(); }
+  // Work scheduled but not yet started.
+  size_t pending() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  void Work() ABSL_LOCKS_EXCLUDED(mu_);
+
+  mutable absl::Mutex mu_;
+  std::deque<std::function<void()>> queue_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_EXECUTOR_H_
@@ -0,0 +1,53 @@
+// Benchmarks the Fraction arithmetic tie-breakers are built from: as standings
+// do, sum each player's opponents' bounded match win percentages, then divide
+// by the number of opponents.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "cpp/fraction.h"
+
+namespace tcgtc {
+namespace {
+
+void BM_OpponentMatchWinPercentage(benchmark::State& state) {
+  const uint32_t players = static_cast<uint32_t>(state.range(0));
+  const uint32_t rounds = static_cast<uint32_t>(state.range(1));
+
+  // Random records, standing in for the rounds played so far.
+  std::mt19937_64 rand(1);
+  std::uniform_int_distribution<uint32_t> outcome(0, 2);
+  std::uniform_int_distribution<uint32_t> pick(0, players - 1);
+  std::vector<Fraction> mwp;
+  std::vector<std::vector<uint32_t>> opponents(players);
+  mwp.reserve(players);
+  for (uint32_t i = 0; i < players; ++i) {
+    uint64_t points = 0;
+    for (uint32_t r = 0; r < rounds; ++r) {
+      const uint32_t o = outcome(rand);
+      points += o == 0 ? 3 : o == 1 ? 1 : 0;
+      opponents[i].push_back(pick(rand));
+    }
+    mwp.push_back(Fraction(points, 3 * rounds).ApplyMtrBound());
+  }
+
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < players; ++i) {
+      Fraction sum(0);
+      for (uint32_t opp : opponents[i]) sum += mwp[opp];
+      benchmark::DoNotOptimize(sum / Fraction(opponents[i].size()));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * players * rounds);
+}
+BENCHMARK(BM_OpponentMatchWinPercentage)
+    ->Args({1000, 5})
+    ->Args({1000, 15})
+    ->Args({10000, 15});
+
+}  // namespace
+}  // namespace tcgtc
+
+BENCHMARK_MAIN();
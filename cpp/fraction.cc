@@ -1,21 +1,152 @@
 #include "fraction.h"
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
 
 namespace tcgtc {
 namespace {
 
-// Euclidean Algorithm (Greatest Common Divisor) implementation.
+// Count of trailing zero bits. Undefined for 0.
+inline int ctz(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return static_cast<int>(idx);
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+// Binary (Stein's) GCD, which replaces the divisions of the Euclidean algorithm
+// with shifts and subtractions.
 uint64_t gcd(uint64_t a, uint64_t b) {
-  while (b != 0) {
-    uint64_t tmp = b;
-    b = a % b;
-    a = tmp;
+  if (a == 0) return b;
+  if (b == 0) return a;
+  const int shift = ctz(a | b);
+  a >>= ctz(a);
+  do {
+    b >>= ctz(b);
+    if (a > b) std::swap(a, b);
+    b -= a;
+  } while (b != 0);
+  return a << shift;
+}
+
+// The full 128-bit product of a and b, as (high, low) words.
+struct Wide {
+  uint64_t hi;
+  uint64_t lo;
+};
+
+inline Wide Mul(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+  return {static_cast<uint64_t>(p >> 64), static_cast<uint64_t>(p)};
+#elif defined(_MSC_VER)
+  Wide out;
+  out.lo = _umul128(a, b, &out.hi);
+  return out;
+#else
+  // Schoolbook multiplication on 32-bit halves.
+  const uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+  const uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+  const uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi;
+  const uint64_t hl = a_hi * b_lo, hh = a_hi * b_hi;
+  const uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+  return {hh + (lh >> 32) + (hl >> 32) + (mid >> 32),
+          (mid << 32) | (ll & 0xFFFFFFFF)};
+#endif
+}
+
+// l + r, and whether it carried out of 128 bits.
+inline Wide Add(const Wide& l, const Wide& r, bool* carry) {
+  const uint64_t lo = l.lo + r.lo;
+  const uint64_t c = lo < l.lo ? 1 : 0;
+  const uint64_t hi = l.hi + r.hi + c;
+  *carry = hi < l.hi || (hi == l.hi && c != 0);
+  return {hi, lo};
+}
+
+// n / d, with the remainder in *rem. d must be non-zero.
+inline Wide DivMod(const Wide& n, uint64_t d, uint64_t* rem) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 v = (static_cast<unsigned __int128>(n.hi) << 64) |
+                              n.lo;
+  const unsigned __int128 q = v / d;
+  *rem = static_cast<uint64_t>(v % d);
+  return {static_cast<uint64_t>(q >> 64), static_cast<uint64_t>(q)};
+#else
+  // Long division of the low word, a bit at a time. The running remainder is
+  // below 2d, i.e. 65 bits, the top of which is carried in `top`.
+  Wide q = {n.hi / d, 0};
+  uint64_t r = n.hi % d;
+  for (int i = 63; i >= 0; --i) {
+    const bool top = (r >> 63) != 0;
+    r = (r << 1) | ((n.lo >> i) & 1);
+    if (top || r >= d) {
+      r -= d;
+      q.lo |= uint64_t{1} << i;
+    }
   }
-  return a;
+  *rem = r;
+  return q;
+#endif
+}
+
+// Number of significant bits in w.
+inline int BitWidth(const Wide& w) {
+  int bits = 0;
+  for (uint64_t x = w.hi != 0 ? w.hi : w.lo; x != 0; x >>= 1) ++bits;
+  return w.hi != 0 ? bits + 64 : bits;
+}
+
+inline Wide ShiftRight(const Wide& w, int shift) {
+  if (shift == 0) return w;
+  if (shift >= 64) return {0, shift >= 128 ? 0 : w.hi >> (shift - 64)};
+  return {w.hi >> shift, (w.lo >> shift) | (w.hi << (64 - shift))};
 }
 
-}  // namespace 
+// A 64-bit fraction close to numer/denom (plus 2^128 if `carry`), for a sum
+// which is not representable exactly: the integer part, plus the fractional
+// part rounded down to a denominator as large as still fits. Saturates if the
+// value itself does not fit.
+std::pair<uint64_t, uint64_t> Approximate(Wide numer, bool carry,
+                                          Wide denom) {
+  constexpr std::pair<uint64_t, uint64_t> kMax = {~uint64_t{0}, 1};
+  // Bring the denominator down to 64 bits, dropping the same bits from the
+  // numerator.
+  const int shift = std::max(BitWidth(denom) - 64, carry ? 1 : 0);
+  numer = ShiftRight(numer, shift);
+  if (carry) numer.hi |= uint64_t{1} << (64 - shift);
+  denom = ShiftRight(denom, shift);
+  if (denom.lo == 0) return kMax;
+
+  uint64_t rem = 0;
+  const Wide whole = DivMod(numer, denom.lo, &rem);
+  if (whole.hi != 0 || whole.lo == ~uint64_t{0}) return kMax;
+  // whole*d + (rem*d)/denom < (whole+1)*d, which fits.
+  const uint64_t d = std::min(denom.lo, ~uint64_t{0} / (whole.lo + 1));
+  uint64_t unused = 0;
+  return {whole.lo * d + DivMod(Mul(rem, d), denom.lo, &unused).lo, d};
+}
+
+inline bool operator==(const Wide& l, const Wide& r) {
+  return l.hi == r.hi && l.lo == r.lo;
+}
+inline bool operator<(const Wide& l, const Wide& r) {
+  return l.hi < r.hi || (l.hi == r.hi && l.lo < r.lo);
+}
+
+// Keep unreduced terms below this, so that a cross multiplied sum of two of
+// them, a*d + c*b < 2 * 2^31 * 2^31 = 2^63, still fits in 64 bits.
+constexpr uint64_t kReduceAbove = uint64_t{1} << 31;
+
+}  // namespace
 
 Fraction::Fraction(uint64_t numer, uint64_t denom) {
   assert(denom != 0);
@@ -24,41 +155,95 @@ Fraction::Fraction(uint64_t numer, uint64_t denom) {
   denom_ = denom / div;
 }
 
-// Used internally if we have already done the GCD computation.
-Fraction::Fraction(uint64_t numer, uint64_t denom, void*) 
+// Used internally if we have already done the GCD computation, or are
+// deliberately deferring it.
+Fraction::Fraction(uint64_t numer, uint64_t denom, void*)
   : numer_(numer), denom_(denom) {
   assert(denom != 0);
 }
 
 // Assuming a,c >= 0, b,d > 0, then:
 // a/b == c/d <=> (b*d)*(a/b) == (b*d)*(c/d) <=> a*d == b*c
+//
+// The products are taken in 128 bits, so this is exact for any operands,
+// reduced or not.
 bool Fraction::operator==(const Fraction& other) const {
-  return this->numer_ * other.denom_ == this->denom_ * other.numer_;
+  if (Small(*this, other)) {
+    return this->numer_ * other.denom_ == this->denom_ * other.numer_;
+  }
+  return Mul(this->numer_, other.denom_) == Mul(this->denom_, other.numer_);
 }
 
 // Assuming a,c >= 0, b,d > 0, then:
 // a/b < c/d <=> (b*d)*(a/b) < (b*d)*(c/d) < a*d < b*c
 bool Fraction::operator<(const Fraction& other) const {
-  return this->numer_ * other.denom_ < this->denom_ * other.numer_;
+  if (Small(*this, other)) {
+    return this->numer_ * other.denom_ < this->denom_ * other.numer_;
+  }
+  return Mul(this->numer_, other.denom_) < Mul(this->denom_, other.numer_);
 }
 
 // Assuming a,c >= 0, b,d > 0, then:
 // a/b + c/d == (a*d)/(b*d) + (c*b)/(d*b) = (a*d + c*b)/(b*d)
 Fraction Fraction::operator+(const Fraction& other) const {
-  uint64_t tmpnum = this->numer_ * other.denom_ + other.numer_ * this->denom_;
-  return Fraction(tmpnum, this->denom_ * other.denom_);
+  Fraction out = *this;
+  out += other;
+  return out.Reduced();
 }
 
+// Reduction is deferred for as long as the terms stay small, since summing
+// (e.g. OMW%) is typically followed by a division, which reduces anyway.
 Fraction& Fraction::operator+=(const Fraction& other) {
-  *this = *this + other;
+  if ((this->numer_ | this->denom_ | other.numer_ | other.denom_) >=
+      kReduceAbove) {
+    // Too large to cross multiply directly. Knuth's addition (TAOCP 4.5.1):
+    // with g = gcd(b, d) and t = a*(d/g) + c*(b/g), the sum in lowest terms is
+    // (t/g2) / ((b/g)*(d/g2)), where g2 = gcd(t, g). t is taken in 128 bits,
+    // so this is exact whenever the reduced sum fits in 64 bits.
+    Fraction l = this->Reduced();
+    Fraction r = other.Reduced();
+    const uint64_t g = gcd(l.denom_, r.denom_);
+    bool carry = false;
+    Wide numer = Add(Mul(l.numer_, r.denom_ / g), Mul(r.numer_, l.denom_ / g),
+                     &carry);
+    Wide denom = Mul(l.denom_ / g, r.denom_);
+    if (!carry) {
+      uint64_t rem = 0;
+      DivMod(numer, g, &rem);
+      const uint64_t g2 = gcd(rem, g);
+      numer = DivMod(numer, g2, &rem);
+      denom = Mul(l.denom_ / g, r.denom_ / g2);
+    }
+    if (carry || numer.hi != 0 || denom.hi != 0) {
+      const auto [n, d] = Approximate(numer, carry, denom);
+      *this = Fraction(n, d);
+      return *this;
+    }
+    *this = Fraction(numer.lo, denom.lo, nullptr);
+    return *this;
+  }
+  if (this->denom_ == other.denom_) {
+    numer_ += other.numer_;
+    if (numer_ >= kReduceAbove) *this = Reduced();
+    return *this;
+  }
+  const uint64_t numer = numer_ * other.denom_ + other.numer_ * denom_;
+  const uint64_t denom = denom_ * other.denom_;
+  *this = denom >= kReduceAbove || numer >= kReduceAbove
+      ? Fraction(numer, denom)
+      : Fraction(numer, denom, nullptr);
   return *this;
 }
 
 // Assuming a,c >= 0, b,d > 0, then:
 // a/b * c/d == a*c/b*d
+//
+// Cross-reducing first keeps the products as small as possible.
 Fraction Fraction::operator*(const Fraction& other) const {
-  return Fraction(this->numer_ * other.numer_, 
-                  this->denom_ * other.denom_);
+  const uint64_t g1 = gcd(this->numer_, other.denom_);
+  const uint64_t g2 = gcd(other.numer_, this->denom_);
+  return Fraction((this->numer_ / g1) * (other.numer_ / g2),
+                  (this->denom_ / g2) * (other.denom_ / g1));
 }
 
 // Represent this in terms of multiplication.
@@ -67,6 +252,13 @@ Fraction Fraction::operator/(const Fraction& other) const {
   return (*this) * inv;
 }
 
+// True if every term is below 2^32, so the cross products fit in 64 bits.
+bool Fraction::Small(const Fraction& l, const Fraction& r) {
+  return ((l.numer_ | l.denom_ | r.numer_ | r.denom_) >> 32) == 0;
+}
+
+Fraction Fraction::Reduced() const { return Fraction(numer_, denom_); }
+
 Fraction Fraction::ApplyMtrBound() const {
   static const Fraction kLowerBound = Fraction(1, 3);
   return *this < kLowerBound ? kLowerBound : *this;
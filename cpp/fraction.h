@@ -9,10 +9,15 @@
 
 namespace tcgtc {
 
-// In theory this class and its comparison functions are prone to overflow
-// operations, but we have a few things mitigating:
-// (1) We store the fraction in reduced form.
-// (2) We deal with small numbers as inputs, generally.
+// Comparisons are exact for any representable fraction: they cross multiply
+// with 128-bit intermediates.
+//
+// Fractions are not necessarily stored in reduced form. operator+= defers the
+// GCD while the terms stay small, since it is used to accumulate sums (e.g. of
+// opponents' MW%) that are then divided, which reduces anyway. Sums of large
+// terms are taken in 128 bits, so are exact whenever the result fits; products
+// could in theory still overflow for huge inputs, but we deal with small
+// numbers.
 class Fraction {
  public:
   Fraction(uint64_t numer, uint64_t denom);
@@ -32,6 +37,13 @@ class Fraction {
   Fraction operator/(const Fraction& other) const;
   Fraction& operator+=(const Fraction& other);
 
+  // The same value, in lowest terms.
+  Fraction Reduced() const;
+
+  // E.g. for persisting the value.
+  uint64_t numer() const { return numer_; }
+  uint64_t denom() const { return denom_; }
+
   // Should only be used for printing and visualization.
   //
   // TODO: Consider only exposing a function that returns the string value, so
@@ -48,6 +60,8 @@ class Fraction {
   // Private constructor for not computing the GCD.
   Fraction(uint64_t numer, uint64_t denom, void* /*unused*/);
 
+  static bool Small(const Fraction& l, const Fraction& r);
+
   uint64_t numer_;
   uint64_t denom_;
 };
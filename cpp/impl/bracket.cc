@@ -0,0 +1,99 @@
+#include "cpp/impl/bracket.h"
+
+#include "cpp/player-match.h"
+#include "cpp/util.h"
+
+namespace tcgtc {
+namespace internal {
+
+absl::StatusOr<Bracket> Bracket::Create(BracketSize size,
+                                        std::vector<Player> seeds) {
+  const auto table = SeedingTable(size);
+  if (table.empty()) return Err("Tournament has no elimination bracket.");
+  if (seeds.size() < static_cast<size_t>(size)) {
+    return Err("Not enough players (", seeds.size(), ") for a Top ",
+               static_cast<int>(size), " bracket.");
+  }
+  seeds.erase(seeds.begin() + static_cast<size_t>(size), seeds.end());
+
+  Bracket out(std::move(seeds), BracketRounds(size));
+  const size_t first_leaf = table.size() - 1;
+  for (size_t i = 0; i < table.size(); ++i) {
+    out.nodes_[first_leaf + i] = table[i];
+  }
+
+  // Byes: a seed whose opponent leaf is empty moves straight up the tree.
+  for (size_t leaf = first_leaf; leaf < out.nodes_.size(); leaf += 2) {
+    const uint8_t l = out.nodes_[leaf];
+    const uint8_t r = out.nodes_[leaf + 1];
+    if (l == kEmpty || r == kEmpty) out.nodes_[(leaf - 1) / 2] = l | r;
+  }
+  return out;
+}
+
+absl::StatusOr<std::vector<Bracket::Pairing>>
+Bracket::Pairings(uint8_t round) const {
+  if (round == 0 || round > depth_) {
+    return Err("Bracket has no elimination round ", round);
+  }
+
+  // The winners of round r are at depth (depth_ - r), which holds nodes
+  // [2^d - 1, 2^(d+1) - 1).
+  const size_t depth = depth_ - round;
+  const size_t begin = (size_t{1} << depth) - 1;
+  const size_t end = (size_t{2} << depth) - 1;
+
+  std::vector<Pairing> out;
+  out.reserve(end - begin);
+  for (size_t node = begin; node < end; ++node) {
+    // Decided by a bye.
+    if (nodes_[node] != kEmpty) continue;
+
+    auto a = At(2 * node + 1);
+    auto b = At(2 * node + 2);
+    if (!a.has_value() || !b.has_value()) {
+      return Err("Elimination round ", round - 1, " is not complete.");
+    }
+    out.push_back(Pairing{static_cast<uint16_t>(node), *a, *b});
+  }
+  return out;
+}
+
+absl::Status Bracket::Advance(uint16_t node, Player::Id winner,
+                              bool parent_paired) {
+  if (auto out = CheckAdvance(node, winner, parent_paired); !out.ok()) {
+    return out;
+  }
+  for (size_t child : {2 * node + 1, 2 * node + 2}) {
+    if (auto p = At(child); p.has_value() && (*p)->id() == winner) {
+      nodes_[node] = nodes_[child];
+      break;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status Bracket::CheckAdvance(uint16_t node, Player::Id winner,
+                                  bool parent_paired) const {
+  if (node >= nodes_.size() / 2) {
+    return Err("Bracket has no match feeding into node ", node);
+  }
+  if (auto p = At(node); p.has_value() && (*p)->id() == winner) {
+    return absl::OkStatus();
+  }
+  // Can't change the result of a match once the next one has been paired (let
+  // alone decided), since its winner is already playing in it.
+  if (node > 0 && (parent_paired || nodes_[(node - 1) / 2] != kEmpty)) {
+    return Err("Cannot change a bracket result which has already advanced.");
+  }
+
+  for (size_t child : {2 * node + 1, 2 * node + 2}) {
+    if (auto p = At(child); p.has_value() && (*p)->id() == winner) {
+      return absl::OkStatus();
+    }
+  }
+  return Err("Player ID (", winner, ") is not playing for bracket node ", node);
+}
+
+}  // namespace internal
+}  // namespace tcgtc
@@ -0,0 +1,119 @@
+// This file defines single elimination brackets, seeded from the final Swiss
+// standings.
+//
+// A bracket is a complete binary tree stored flat, in heap order: node 0 is the
+// final, and the children of node i are nodes 2i+1 and 2i+2. Each node holds
+// the seed which won (or was seeded into) that spot, so advancing a winner is a
+// single write. Brackets which are not a power of two (e.g. Top 6) are padded
+// out with empty leaves, which give byes to the top seeds.
+
+#ifndef _TCGTC_BRACKET_H_
+#define _TCGTC_BRACKET_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "cpp/definitions.h"
+#include "cpp/match-id.h"
+
+namespace tcgtc {
+namespace internal {
+
+// Currently only support the following bracket sizes.
+enum class BracketSize : uint8_t {
+  kNoBracket = 0,
+  kTop2 = 2,
+  kTop4 = 4,
+  kTop6 = 6,
+  kTop8 = 8,
+};
+
+// Seeds for each leaf of the bracket, left to right. A seed of 0 is a bye.
+// Seeds are placed so that the top two can only meet in the final, the top
+// four only in the semi-finals, and so on.
+constexpr std::array<uint8_t, 2> kTop2Seeding = {1, 2};
+constexpr std::array<uint8_t, 4> kTop4Seeding = {1, 4, 2, 3};
+constexpr std::array<uint8_t, 8> kTop6Seeding = {1, 0, 4, 5, 2, 0, 3, 6};
+constexpr std::array<uint8_t, 8> kTop8Seeding = {1, 8, 4, 5, 2, 7, 3, 6};
+
+constexpr absl::Span<const uint8_t> SeedingTable(BracketSize size) {
+  switch (size) {
+    case BracketSize::kTop2: return kTop2Seeding;
+    case BracketSize::kTop4: return kTop4Seeding;
+    case BracketSize::kTop6: return kTop6Seeding;
+    case BracketSize::kTop8: return kTop8Seeding;
+    default: return {};
+  }
+}
+
+// The number of elimination rounds needed to play out a bracket.
+constexpr uint8_t BracketRounds(BracketSize size) {
+  uint8_t rounds = 0;
+  for (size_t leaves = SeedingTable(size).size(); leaves > 1; leaves >>= 1) {
+    ++rounds;
+  }
+  return rounds;
+}
+
+class Bracket {
+ public:
+  // `seeds` are the top players from the standings, in order.
+  static absl::StatusOr<Bracket> Create(BracketSize size,
+                                        std::vector<Player> seeds);
+
+  struct Pairing {
+    // The node the winner of this pairing advances to. Used as the match number
+    // (plus one) for elimination matches.
+    uint16_t node;
+    Player a;
+    Player b;
+  };
+  // The matches to be played in the given bracket round (1-indexed). Errors if
+  // an earlier round has not been completed.
+  absl::StatusOr<std::vector<Pairing>> Pairings(uint8_t round) const;
+
+  // Records `winner` as having won the match feeding into `node`. Once the
+  // match for the node's parent exists (`parent_paired`, i.e. the next round
+  // has been paired), its players are fixed, so only the winner already
+  // recorded is accepted.
+  absl::Status Advance(uint16_t node, Player::Id winner,
+                       bool parent_paired = false);
+  // OK iff. Advance(node, winner, parent_paired) would succeed. Recording the
+  // winner already recorded changes nothing, so always succeeds.
+  absl::Status CheckAdvance(uint16_t node, Player::Id winner,
+                            bool parent_paired = false) const;
+
+  uint8_t rounds() const { return depth_; }
+  // As created with, i.e. top seed first.
+  const std::vector<Player>& seeds() const { return seeds_; }
+  std::optional<Player> champion() const { return At(0); }
+
+ private:
+  static constexpr uint8_t kEmpty = 0;
+
+  Bracket(std::vector<Player> seeds, uint8_t depth)
+    : seeds_(std::move(seeds)), depth_(depth),
+      nodes_((size_t{2} << depth) - 1, kEmpty) {}
+
+  std::optional<Player> At(size_t node) const {
+    if (nodes_[node] == kEmpty) return std::nullopt;
+    return seeds_[nodes_[node] - 1];
+  }
+
+  // Index 0 is seed 1.
+  std::vector<Player> seeds_;
+  // Log2 of the number of leaves.
+  uint8_t depth_;
+  // The seed occupying each node, or kEmpty.
+  std::vector<uint8_t> nodes_;
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_BRACKET_H_
@@ -0,0 +1,217 @@
+#include "cpp/impl/compact-round.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "cpp/impl/match.h"
+#include "cpp/impl/player.h"
+#include "cpp/util.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+constexpr uint16_t kMaxColumnGames = std::numeric_limits<uint8_t>::max();
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<const CompactRound>> CompactRound::Build(
+    RoundId round, const std::vector<Match>& matches,
+    std::shared_ptr<const std::vector<Player>> roster) {
+  absl::flat_hash_map<Player::Id, uint32_t> index;
+  index.reserve(roster->size());
+  for (uint32_t i = 0; i < roster->size(); ++i) {
+    index.insert({(*roster)[i]->id(), i});
+  }
+  auto index_of = [&index](const Player& p) -> absl::StatusOr<uint32_t> {
+    if (auto it = index.find(p->id()); it != index.end()) return it->second;
+    return Err(p->ErrorStringId(), " is not in the roster.");
+  };
+
+  std::vector<uint32_t> order(matches.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&matches](uint32_t l, uint32_t r) {
+    return matches[l]->id().number < matches[r]->id().number;
+  });
+
+  std::shared_ptr<CompactRound> out(new CompactRound(round, std::move(roster)));
+  out->number_.reserve(matches.size());
+  out->a_.reserve(matches.size());
+  out->b_.reserve(matches.size());
+
+  // Check everyone is in the roster, and every match has a result, before
+  // sealing anything, so that a failed build leaves the matches as they were.
+  // A committed result is only ever replaced (or retired with its round), so
+  // Seal() below then succeeds.
+  for (uint32_t i : order) {
+    const Match& m = matches[i];
+    if (m->id().round != round) {
+      return Err(m->id().ErrorStringId(), " is not in Round ",
+                 (round & kRoundMask));
+    }
+    if (!m->results().committed.has_value()) {
+      return Err(m->id().ErrorStringId(), " has no result yet.");
+    }
+    auto a = index_of(m->player_a());
+    if (!a.ok()) return a.status();
+    uint32_t b = kNoOpponent;
+    if (!m->is_bye()) {
+      auto found = index_of(*m->player_b());
+      if (!found.ok()) return found.status();
+      b = *found;
+    }
+    out->number_.push_back(m->id().number);
+    out->a_.push_back(*a);
+    out->b_.push_back(b);
+  }
+
+  out->winner_.reserve(matches.size());
+  out->games_won_.reserve(matches.size());
+  out->games_lost_.reserve(matches.size());
+  out->games_drawn_.reserve(matches.size());
+  absl::MutexLock l(&out->mu_);
+  for (uint32_t row = 0; row < order.size(); ++row) {
+    const Match& m = matches[order[row]];
+    auto result = m->Seal();
+    if (!result.ok()) return result.status();
+
+    Winner winner = Winner::kDraw;
+    if (m->assigned_loss()) {
+      winner = Winner::kNoOne;
+    } else if (result->winner.has_value()) {
+      winner = *result->winner == m->player_a()->id() ? Winner::kA : Winner::kB;
+    }
+    out->winner_.push_back(winner);
+    auto column = [&out, row, &result](uint16_t games) {
+      // Too many to store; the whole result goes in the overlay instead.
+      if (games > kMaxColumnGames) out->overlay_.insert({row, *result});
+      return static_cast<uint8_t>(std::min(games, kMaxColumnGames));
+    };
+    out->games_won_.push_back(column(result->winner_games_won));
+    out->games_lost_.push_back(column(result->winner_games_lost));
+    out->games_drawn_.push_back(column(result->games_drawn));
+  }
+  return out;
+}
+
+std::optional<uint32_t> CompactRound::RowOf(uint32_t number) const {
+  auto it = std::lower_bound(number_.begin(), number_.end(), number);
+  if (it == number_.end() || *it != number) return std::nullopt;
+  return static_cast<uint32_t>(it - number_.begin());
+}
+
+MatchResult CompactRound::ResultLocked(uint32_t row) const {
+  if (auto it = overlay_.find(row); it != overlay_.end()) return it->second;
+
+  MatchResult out;
+  out.id = MatchId{round_, number_[row]};
+  switch (winner_[row]) {
+    case Winner::kA:
+      out.winner = (*roster_)[a_[row]]->id();
+      break;
+    case Winner::kB:
+      out.winner = (*roster_)[b_[row]]->id();
+      break;
+    case Winner::kDraw:
+      break;
+    case Winner::kNoOne:
+      out.winner = kNoPlayer;
+      break;
+  }
+  out.winner_games_won = games_won_[row];
+  out.winner_games_lost = games_lost_[row];
+  out.games_drawn = games_drawn_[row];
+  return out;
+}
+
+Match CompactRound::MatchLocked(uint32_t row, bool sealed) const {
+  std::optional<Player> b;
+  if (b_[row] != kNoOpponent) b = (*roster_)[b_[row]];
+  return Match::Impl::CreateCompacted(
+      (*roster_)[a_[row]], std::move(b), MatchId{round_, number_[row]},
+      winner_[row] == Winner::kNoOne, ResultLocked(row), sealed);
+}
+
+std::optional<Match> CompactRound::Find(uint32_t number) const {
+  auto row = RowOf(number);
+  if (!row.has_value()) return std::nullopt;
+  absl::ReaderMutexLock l(&mu_);
+  return MatchLocked(*row);
+}
+
+std::vector<Match> CompactRound::Matches() const {
+  std::vector<Match> out;
+  out.reserve(size());
+  absl::ReaderMutexLock l(&mu_);
+  for (uint32_t row = 0; row < size(); ++row) out.push_back(MatchLocked(row));
+  return out;
+}
+
+absl::StatusOr<Match> CompactRound::Correct(const MatchResult& result) const {
+  auto row = RowOf(result.id.number);
+  if (result.id.round != round_ || !row.has_value()) {
+    return Err("No Match in this tournament for id ",
+               result.id.ErrorStringId());
+  }
+  absl::MutexLock l(&mu_);
+  Match m = MatchLocked(*row, /*sealed=*/false);
+  if (auto out = m->JudgeSetResult(result); !out.ok()) return out;
+  overlay_.insert_or_assign(*row, result);
+  return MatchLocked(*row);
+}
+
+void CompactRound::AddToRecords(StandingsSnapshot* snapshot) const {
+  // Elimination rounds are not part of tie-breakers.
+  if (!MatchId::IsSwiss(round_)) return;
+
+  // Snapshots are usually of the same roster, perhaps grown since, in which
+  // case indices carry over as they are.
+  const std::vector<Player>& players = snapshot->players;
+  const std::vector<Player>& roster = *roster_;
+  bool same = players.size() >= roster.size();
+  for (size_t i = 0; same && i < roster.size(); ++i) {
+    same = players[i].get() == roster[i].get();
+  }
+  std::vector<uint32_t> slot;
+  if (!same) {
+    absl::flat_hash_map<Player::Id, uint32_t> index;
+    index.reserve(players.size());
+    for (uint32_t i = 0; i < players.size(); ++i) {
+      index.insert({players[i]->id(), i});
+    }
+    slot.assign(roster.size(), kNoOpponent);
+    for (uint32_t i = 0; i < roster.size(); ++i) {
+      if (auto it = index.find(roster[i]->id()); it != index.end()) {
+        slot[i] = it->second;
+      }
+    }
+  }
+  auto to_snapshot = [&](uint32_t i) { return same ? i : slot[i]; };
+
+  // Only players whose own record has let go of this round.
+  std::vector<PlayerRecord>& records = snapshot->records;
+  auto wants = [&](uint32_t i) {
+    return i != kNoOpponent && round_ <= records[i].compacted_through;
+  };
+  for (uint32_t row = 0; row < size(); ++row) {
+    const uint32_t a = to_snapshot(a_[row]);
+    if (b_[row] == kNoOpponent) {
+      if (winner_[row] != Winner::kNoOne && wants(a)) ++records[a].byes;
+      continue;
+    }
+    const uint32_t b = to_snapshot(b_[row]);
+    if (b == kNoOpponent || a == kNoOpponent) continue;
+    if (wants(a)) records[a].opponents.push_back(b);
+    if (wants(b)) records[b].opponents.push_back(a);
+  }
+}
+
+size_t CompactRound::BytesUsed() const {
+  size_t bytes = sizeof(CompactRound) + kSharedControlBytes +
+                 HeapBytes(number_) + HeapBytes(a_) + HeapBytes(b_) +
+                 HeapBytes(winner_) + HeapBytes(games_won_) +
+                 HeapBytes(games_lost_) + HeapBytes(games_drawn_);
+  absl::ReaderMutexLock l(&mu_);
+  return bytes + HeapBytes(overlay_);
+}
+
+}  // namespace internal
+}  // namespace tcgtc
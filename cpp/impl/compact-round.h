@@ -0,0 +1,110 @@
+// This file defines the storage for rounds which are over. Once the next round
+// is paired, a round's results only change through (rare) judge fixes, so its
+// matches are stored column by column, a few bytes each, rather than as Match
+// objects with their own lock, report slots and references to both players.
+// Scans over them (e.g. collecting opponents for tie-breakers) then read a few
+// contiguous arrays.
+//
+// Judge fixes go into a small overlay on top of the columns. Reads that need a
+// Match (e.g. GetMatch) get a read-only copy built from the columns.
+
+#ifndef _TCGTC_COMPACT_ROUND_H_
+#define _TCGTC_COMPACT_ROUND_H_
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "cpp/definitions.h"
+#include "cpp/match-id.h"
+#include "cpp/match-result.h"
+#include "cpp/memory-usage.h"
+#include "cpp/impl/standings.h"
+
+namespace tcgtc {
+namespace internal {
+
+class CompactRound {
+ public:
+  // Seals every match (see MatchImpl::Seal), each of which must have a
+  // committed result. Players are numbered by their position in `roster`,
+  // which must include everyone in the round, and which may be shared with
+  // other rounds.
+  static absl::StatusOr<std::shared_ptr<const CompactRound>> Build(
+      RoundId round, const std::vector<Match>& matches,
+      std::shared_ptr<const std::vector<Player>> roster);
+
+  RoundId round() const { return round_; }
+  size_t size() const { return number_.size(); }
+
+  // A sealed copy of the match, with its current result. O(log n).
+  std::optional<Match> Find(uint32_t number) const ABSL_LOCKS_EXCLUDED(mu_);
+  // Sealed copies of every match, in match number order.
+  std::vector<Match> Matches() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Applies a judge's fix with the same checks, and the same updates to the
+  // players, as for a live match. Fixes to one round are applied in turn.
+  // Returns a sealed copy of the fixed match.
+  absl::StatusOr<Match> Correct(const MatchResult& result) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Adds each Swiss opponent and bye in this round to the records of the
+  // players whose record leaves it out (see PlayerRecord::compacted_through).
+  void AddToRecords(StandingsSnapshot* snapshot) const;
+
+  // The columns and overlay, in bytes (see cpp/memory-usage.h). The roster is
+  // shared, so is not counted.
+  size_t BytesUsed() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  static constexpr uint32_t kNoOpponent = std::numeric_limits<uint32_t>::max();
+
+  // Who won, relative to the row's players.
+  enum class Winner : uint8_t {
+    kA,
+    kB,
+    kDraw,
+    // An assigned loss, which no one won.
+    kNoOne,
+  };
+
+  CompactRound(RoundId round, std::shared_ptr<const std::vector<Player>> roster)
+    : round_(round), roster_(std::move(roster)) {}
+
+  std::optional<uint32_t> RowOf(uint32_t number) const;
+  MatchResult ResultLocked(uint32_t row) const ABSL_SHARED_LOCKS_REQUIRED(mu_);
+  // A copy of the match in `row`.
+  Match MatchLocked(uint32_t row, bool sealed = true) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+
+  const RoundId round_;
+  const std::shared_ptr<const std::vector<Player>> roster_;
+
+  // One entry per match, in match number order. Never changed once built.
+  std::vector<uint32_t> number_;
+  // Indices into roster_.
+  std::vector<uint32_t> a_;
+  // kNoOpponent for a bye or an assigned loss.
+  std::vector<uint32_t> b_;
+  std::vector<Winner> winner_;
+  std::vector<uint8_t> games_won_;
+  std::vector<uint8_t> games_lost_;
+  std::vector<uint8_t> games_drawn_;
+
+  mutable absl::Mutex mu_;
+  // Results fixed since the round was compacted, or whose game counts do not
+  // fit the columns, by row.
+  mutable absl::flat_hash_map<uint32_t, MatchResult> overlay_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_COMPACT_ROUND_H_
@@ -0,0 +1,217 @@
+#include "cpp/impl/forecast.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "cpp/executor.h"
+#include "cpp/metrics.h"
+#include "cpp/pairings/isomorphism.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+
+// Shared, read-only, by every simulation.
+struct Shared {
+  const ForecastInput& input;
+  const ForecastOptions& opts;
+  absl::flat_hash_map<Player::Id, uint32_t> index;
+  std::vector<bool> active;
+};
+
+// Records a randomized result between a and b, who are already recorded as
+// opponents. Points follow MatchResult: 3 per match or game won, 1 per draw.
+template <typename URBG>
+void PlayMatch(PlayerRecord& a, PlayerRecord& b, double draw_probability,
+               URBG& urbg) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  if (unit(urbg) < draw_probability) {
+    // Simulated as 1-1 in games.
+    for (PlayerRecord* p : {&a, &b}) {
+      p->match_points += 1;
+      p->game_points += 3;
+      p->games_played += 2;
+    }
+    return;
+  }
+  PlayerRecord* winner = &a;
+  PlayerRecord* loser = &b;
+  if (urbg() & 1) std::swap(winner, loser);
+  const bool went_to_three = urbg() & 1;
+  winner->match_points += 3;
+  winner->game_points += 6;
+  loser->game_points += went_to_three ? 3 : 0;
+  winner->games_played += went_to_three ? 3 : 2;
+  loser->games_played += went_to_three ? 3 : 2;
+}
+
+// MTR states that a Bye is considered won 2-0 in games.
+void PlayBye(PlayerRecord& p) {
+  p.match_points += 3;
+  p.game_points += 6;
+  p.games_played += 2;
+  p.matches_played += 1;
+  p.byes += 1;
+}
+
+// Plays out the rest of the event once, starting from the snapshot, and adds
+// one to `counts` for each player making the cut. `sim` is scratch space,
+// reused across calls.
+void Simulate(const Shared& shared, uint64_t i, StandingsSnapshot& sim,
+              std::vector<uint32_t>& counts) {
+  const ForecastInput& input = shared.input;
+  std::seed_seq seq{static_cast<uint32_t>(shared.opts.seed),
+                    static_cast<uint32_t>(shared.opts.seed >> 32),
+                    static_cast<uint32_t>(i), static_cast<uint32_t>(i >> 32)};
+  std::mt19937_64 rand(seq);
+
+  // Assignment reuses each record's opponent storage from the last run.
+  sim.records = input.snapshot.records;
+  auto& records = sim.records;
+  const double draws = shared.opts.draw_probability;
+
+  for (const auto& [a, b] : input.outstanding) {
+    PlayMatch(records[a], records[b], draws, rand);
+  }
+
+  auto may_pair = [&records](uint32_t a, uint32_t b) {
+    const auto& opps = records[a].opponents;
+    return std::find(opps.begin(), opps.end(), b) == opps.end();
+  };
+  ScopedSimulation simulation;
+  for (uint8_t round = 0; round < input.remaining_rounds; ++round) {
+    BasicScoreGroups<uint32_t> groups;
+    for (uint32_t p : input.active) {
+      groups[records[p].match_points].push_back(p);
+    }
+    auto pairing = PairScoreGroups(std::move(groups), may_pair, rand);
+    for (const auto& [a, b] : pairing.paired) {
+      records[a].opponents.push_back(b);
+      records[b].opponents.push_back(a);
+      records[a].matches_played += 1;
+      records[b].matches_played += 1;
+      PlayMatch(records[a], records[b], draws, rand);
+    }
+    for (uint32_t p : pairing.unpaired) PlayBye(records[p]);
+  }
+
+  // Only active players make the cut, so look past any dropped players.
+  const size_t inactive = sim.players.size() - input.active.size();
+  Standings standings = ComputeStandings(sim, input.rules);
+  size_t made = 0;
+  for (const auto& s : standings.TopK(input.cut + inactive)) {
+    if (made == input.cut) break;
+    const uint32_t p = shared.index.at(s.p->id());
+    if (!shared.active[p]) continue;
+    ++counts[p];
+    ++made;
+  }
+}
+
+// The simulations of one forecast. Helpers scheduled on an executor may only
+// start once the forecast is over, so they share ownership of this, and touch
+// `shared` only after claiming a simulation still to run.
+struct Job {
+  Job(const Shared* shared, uint64_t simulations)
+    : shared(shared), simulations(simulations) {}
+
+  const Shared* const shared;
+  const uint64_t simulations;
+  std::atomic<uint64_t> next{0};
+
+  absl::Mutex mu;
+  std::vector<uint32_t> counts ABSL_GUARDED_BY(mu);
+  // Simulations run and merged into `counts`.
+  uint64_t done ABSL_GUARDED_BY(mu) = 0;
+};
+
+// Runs simulations until none are left to claim, then merges their counts.
+void Work(Job& job) {
+  std::optional<StandingsSnapshot> sim;
+  std::vector<uint32_t> local;
+  uint64_t ran = 0;
+  for (uint64_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+       i < job.simulations;
+       i = job.next.fetch_add(1, std::memory_order_relaxed)) {
+    if (!sim.has_value()) {
+      const StandingsSnapshot& snapshot = job.shared->input.snapshot;
+      sim.emplace();
+      sim->round = snapshot.round;
+      sim->players = snapshot.players;
+      local.assign(snapshot.players.size(), 0);
+    }
+    Simulate(*job.shared, i, *sim, local);
+    ++ran;
+  }
+  if (ran == 0) return;
+  absl::MutexLock l(&job.mu);
+  for (size_t p = 0; p < local.size(); ++p) job.counts[p] += local[p];
+  job.done += ran;
+}
+
+Executor& SharedPool() {
+  static Executor* pool = new Executor(
+      std::max<size_t>(1, std::thread::hardware_concurrency()));
+  return *pool;
+}
+
+}  // namespace
+
+std::vector<CutForecast> ForecastCut(const ForecastInput& input,
+                                     const ForecastOptions& opts) {
+  const auto& players = input.snapshot.players;
+  Shared shared{input, opts, {}, std::vector<bool>(players.size(), false)};
+  shared.index.reserve(players.size());
+  for (uint32_t i = 0; i < players.size(); ++i) {
+    shared.index.insert({players[i]->id(), i});
+  }
+  for (uint32_t p : input.active) shared.active[p] = true;
+
+  Executor& pool = opts.executor != nullptr ? *opts.executor : SharedPool();
+  size_t threads = opts.num_threads;
+  if (threads == 0) threads = pool.num_threads() + 1;
+  threads = std::max<size_t>(1, std::min<size_t>(threads, opts.simulations));
+
+  auto job = std::make_shared<Job>(&shared, opts.simulations);
+  job->counts.assign(players.size(), 0);
+  // The caller works too, so the forecast finishes even if every executor
+  // thread is busy (or it is called from one of them).
+  for (size_t t = 1; t < threads; ++t) {
+    pool.Schedule([job]() { Work(*job); });
+  }
+  Work(*job);
+
+  // Every simulation has been claimed; wait for those still running.
+  auto finished = [&job]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(job->mu) {
+    return job->done == job->simulations;
+  };
+  std::vector<uint32_t> counts;
+  {
+    absl::MutexLock l(&job->mu);
+    job->mu.Await(absl::Condition(&finished));
+    counts = std::move(job->counts);
+  }
+
+  std::vector<CutForecast> out;
+  out.reserve(input.active.size());
+  for (uint32_t p : input.active) {
+    const double probability = opts.simulations == 0
+        ? 0.0 : static_cast<double>(counts[p]) / opts.simulations;
+    out.push_back(CutForecast{players[p], probability});
+  }
+  std::sort(out.begin(), out.end(), [](const auto& l, const auto& r) {
+    if (l.probability != r.probability) return l.probability > r.probability;
+    return l.p->id() < r.p->id();
+  });
+  return out;
+}
+
+}  // namespace internal
+}  // namespace tcgtc
@@ -0,0 +1,76 @@
+// This file defines forecasting of each player's odds of making the top cut,
+// by Monte Carlo simulation of the remaining Swiss rounds.
+//
+// A simulation plays out the rest of the event on a copy of the records in a
+// StandingsSnapshot, so it never touches a Player, Match or lock. Each round is
+// paired with the same score group pairing used for real rounds, results are
+// randomized, and the final standings are computed with the tournament's
+// tie-breakers. Simulations are independent, so they are spread across a pool
+// of threads and only their cut counts are merged.
+
+#ifndef _TCGTC_FORECAST_H_
+#define _TCGTC_FORECAST_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "cpp/executor.h"
+#include "cpp/impl/standings.h"
+#include "cpp/player-match.h"
+#include "cpp/tiebreaker.h"
+
+namespace tcgtc {
+namespace internal {
+
+struct ForecastOptions {
+  uint32_t simulations = 2000;
+
+  // Simulation i draws from its own random stream, seeded from (seed, i), so
+  // threads never share a generator.
+  uint64_t seed = 0;
+
+  // The chance that a simulated match ends in a draw. Otherwise each player is
+  // equally likely to win.
+  double draw_probability = 0.05;
+
+  // The number of players making the cut. Defaults to the bracket size.
+  size_t cut = 0;
+
+  // Runs the simulations, alongside the calling thread. If unset, a pool of
+  // hardware threads shared by every forecast in the process is used.
+  Executor* executor = nullptr;
+
+  // The most threads, counting the caller, to spread the simulations across.
+  // Defaults to the executor's threads, plus the caller.
+  size_t num_threads = 0;
+};
+
+struct ForecastInput {
+  StandingsSnapshot snapshot;
+  // Indices into snapshot.players of those still in the event. Only these are
+  // paired, and only these can make the cut.
+  std::vector<uint32_t> active;
+  // Current round pairings, by index, which are still awaiting a result.
+  std::vector<std::pair<uint32_t, uint32_t>> outstanding;
+  // Swiss rounds still to be paired.
+  uint8_t remaining_rounds = 0;
+  size_t cut = 0;
+  TieBreakRules rules = TieBreakRules::kMtr;
+};
+
+struct CutForecast {
+  Player p;
+  // In [0, 1].
+  double probability;
+};
+
+// Every active player's odds of making the cut, most likely first. Blocks until
+// all simulations are done.
+std::vector<CutForecast> ForecastCut(const ForecastInput& input,
+                                     const ForecastOptions& opts);
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_FORECAST_H_
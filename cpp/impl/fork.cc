@@ -0,0 +1,289 @@
+#include "cpp/impl/fork.h"
+
+#include <algorithm>
+#include <random>
+
+#include "cpp/metrics.h"
+#include "cpp/impl/round.h"
+#include "cpp/pairings/isomorphism.h"
+#include "cpp/util.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+void EraseOpponent(PlayerRecord& r, uint32_t opp) {
+  auto it = std::find(r.opponents.begin(), r.opponents.end(), opp);
+  if (it != r.opponents.end()) r.opponents.erase(it);
+}
+}  // namespace
+
+size_t TournamentFork::Base::BytesUsed() const {
+  size_t bytes = sizeof(Base) + kSharedControlBytes +
+                 HeapBytes(snapshot.players) + HeapBytes(snapshot.records) +
+                 HeapBytes(index) + HeapBytes(active) + HeapBytes(matches) +
+                 HeapBytes(rounds) + HeapBytes(avoidance);
+  for (const PlayerRecord& record : snapshot.records) {
+    bytes += HeapBytes(record.opponents);
+  }
+  for (const auto& [round, ids] : rounds) bytes += HeapBytes(ids);
+  for (const auto& [player, player_rules] : avoidance) {
+    bytes += HeapBytes(player_rules);
+  }
+  return bytes;
+}
+
+std::shared_ptr<const TournamentFork::Base> TournamentFork::CaptureBase(
+    std::vector<Player> players, const std::vector<Player::Id>& active,
+    const std::vector<Round>& rounds,
+    const absl::flat_hash_map<Player::Id, std::vector<AvoidanceRule>>&
+        avoidance,
+    uint8_t swiss_rounds, TieBreakRules rules) {
+  auto base = std::make_shared<Base>();
+  const RoundId current = rounds.empty() ? 0 : rounds.back()->id();
+  base->snapshot = CaptureStandingsSnapshot(current, std::move(players));
+  for (const auto& round : rounds) {
+    if (auto compact = round->compact(); compact != nullptr) {
+      compact->AddToRecords(&base->snapshot);
+    }
+  }
+  base->swiss_rounds = swiss_rounds;
+  base->rules = rules;
+
+  const auto& snapshot_players = base->snapshot.players;
+  base->index.reserve(snapshot_players.size());
+  for (uint32_t i = 0; i < snapshot_players.size(); ++i) {
+    base->index.insert({snapshot_players[i]->id(), i});
+  }
+  base->active.reserve(active.size());
+  for (Player::Id id : active) {
+    if (auto it = base->index.find(id); it != base->index.end()) {
+      base->active.push_back(it->second);
+    }
+  }
+  for (const auto& [id, player_rules] : avoidance) {
+    if (auto it = base->index.find(id); it != base->index.end()) {
+      base->avoidance.insert({it->second, player_rules});
+    }
+  }
+
+  for (const auto& round : rounds) {
+    auto& ids = base->rounds[round->id()];
+    for (const auto& m : round->Matches()) {
+      auto a = base->index.find(m->player_a()->id());
+      if (a == base->index.end()) continue;
+      Pairing p{m->id(), a->second, std::nullopt, std::nullopt};
+      if (!m->is_bye()) {
+        auto b = base->index.find((*m->player_b())->id());
+        if (b == base->index.end()) continue;
+        p.b = b->second;
+      }
+      if (auto result = m->confirmed_result(); result.ok()) p.result = *result;
+      ids.push_back(p.id);
+      base->matches.insert({p.id, std::move(p)});
+    }
+    std::sort(ids.begin(), ids.end());
+  }
+  return base;
+}
+
+TournamentFork::TournamentFork(std::shared_ptr<const Base> base)
+  : base_(std::move(base)), round_(base_->snapshot.round) {}
+
+absl::StatusOr<uint32_t> TournamentFork::IndexOf(Player::Id player) const {
+  if (auto it = base_->index.find(player); it != base_->index.end()) {
+    return it->second;
+  }
+  return Err("No Player in this tournament for id ", player);
+}
+
+// Records ---------------------------------------------------------------------
+const PlayerRecord& TournamentFork::Record(uint32_t index) const {
+  if (auto it = records_.find(index); it != records_.end()) return it->second;
+  return base_->snapshot.records[index];
+}
+
+PlayerRecord& TournamentFork::MutableRecord(uint32_t index) {
+  auto it = records_.find(index);
+  if (it == records_.end()) {
+    it = records_.insert({index, base_->snapshot.records[index]}).first;
+  }
+  return it->second;
+}
+
+void TournamentFork::AddResult(const Pairing& m, const MatchResult& result) {
+  for (std::optional<uint32_t> p : {std::optional<uint32_t>(m.a), m.b}) {
+    if (!p.has_value()) continue;
+    const Player::Id id = player(*p)->id();
+    PlayerRecord& r = MutableRecord(*p);
+    r.match_points += result.match_points(id);
+    r.game_points += result.game_points(id);
+    r.games_played += result.games_played();
+  }
+}
+
+void TournamentFork::RemoveResult(const Pairing& m, const MatchResult& result) {
+  for (std::optional<uint32_t> p : {std::optional<uint32_t>(m.a), m.b}) {
+    if (!p.has_value()) continue;
+    const Player::Id id = player(*p)->id();
+    PlayerRecord& r = MutableRecord(*p);
+    r.match_points -= result.match_points(id);
+    r.game_points -= result.game_points(id);
+    r.games_played -= result.games_played();
+  }
+}
+
+// Matches ---------------------------------------------------------------------
+const std::vector<MatchId>& TournamentFork::RoundMatches(RoundId round) const {
+  static const std::vector<MatchId> kNone;
+  if (auto it = rounds_.find(round); it != rounds_.end()) return it->second;
+  if (auto it = base_->rounds.find(round); it != base_->rounds.end()) {
+    return it->second;
+  }
+  return kNone;
+}
+
+absl::StatusOr<TournamentFork::Pairing> TournamentFork::GetMatch(
+    MatchId id) const {
+  if (auto it = matches_.find(id); it != matches_.end()) {
+    if (it->second.has_value()) return *it->second;
+  } else if (auto base_it = base_->matches.find(id);
+             base_it != base_->matches.end()) {
+    return base_it->second;
+  }
+  return Err("No Match in this fork for id ", id.ErrorStringId());
+}
+
+std::vector<TournamentFork::Pairing> TournamentFork::RoundPairings(
+    RoundId round) const {
+  std::vector<Pairing> out;
+  const auto& ids = RoundMatches(round);
+  out.reserve(ids.size());
+  for (MatchId id : ids) {
+    if (auto m = GetMatch(id); m.ok()) out.push_back(*std::move(m));
+  }
+  return out;
+}
+
+absl::Status TournamentFork::SetResult(const MatchResult& result) {
+  auto m = GetMatch(result.id);
+  if (!m.ok()) return m.status();
+  if (!m->b.has_value()) return Err("Cannot change the result of a Bye.");
+
+  if (result.winner.has_value()) {
+    if (*result.winner != player(m->a)->id() &&
+        *result.winner != player(*m->b)->id()) {
+      return Err(result.id.ErrorStringId(), " report has winner ",
+                 *result.winner, " not in this match.");
+    }
+    if (result.winner_games_won <= result.winner_games_lost) {
+      return Err(result.id.ErrorStringId(), " winner must win more games.");
+    }
+  } else if (result.winner_games_won != result.winner_games_lost) {
+    return Err("Reported draw ", result.id.ErrorStringId(),
+               " does not have equal game wins.");
+  }
+
+  if (m->result.has_value()) RemoveResult(*m, *m->result);
+  AddResult(*m, result);
+  m->result = result;
+  matches_[result.id] = *std::move(m);
+  return absl::OkStatus();
+}
+
+// Pairing ---------------------------------------------------------------------
+absl::StatusOr<std::vector<TournamentFork::Pairing>>
+TournamentFork::RepairRound(uint64_t seed) {
+  if (round_ == 0) return Err("Round 1 has not yet started!");
+
+  for (const auto& m : RoundPairings(round_)) {
+    if (m.result.has_value()) RemoveResult(m, *m.result);
+    PlayerRecord& a = MutableRecord(m.a);
+    a.matches_played -= 1;
+    if (m.b.has_value()) {
+      PlayerRecord& b = MutableRecord(*m.b);
+      b.matches_played -= 1;
+      EraseOpponent(a, *m.b);
+      EraseOpponent(b, m.a);
+    } else if (m.result.has_value() && m.result->winner == player(m.a)->id()) {
+      // A Bye, rather than an assigned loss.
+      a.byes -= 1;
+    }
+    matches_[m.id] = std::nullopt;
+  }
+  rounds_[round_].clear();
+  return PairRound(seed);
+}
+
+absl::StatusOr<std::vector<TournamentFork::Pairing>>
+TournamentFork::PairNextRound(uint64_t seed) {
+  if (round_ >= base_->swiss_rounds) return Err("Swiss rounds are complete.");
+  for (const auto& m : RoundPairings(round_)) {
+    if (!m.result.has_value()) {
+      return Err("Round ", (round_ & kRoundMask), " is not complete!");
+    }
+  }
+  ++round_;
+  return PairRound(seed);
+}
+
+absl::StatusOr<std::vector<TournamentFork::Pairing>>
+TournamentFork::PairRound(uint64_t seed) {
+  std::mt19937_64 rand(seed);
+  BasicScoreGroups<uint32_t> groups;
+  for (uint32_t p : base_->active) {
+    groups[Record(p).match_points].push_back(p);
+  }
+  CompiledAvoidance avoid(base_->snapshot.players.size(), round_);
+  for (const auto& [p, rules] : base_->avoidance) avoid.Add(p, rules);
+  auto may_pair = [&](uint32_t a, uint32_t b) {
+    const auto& opps = Record(a).opponents;
+    return std::find(opps.begin(), opps.end(), b) == opps.end() &&
+           !avoid.Forbidden(a, b);
+  };
+  auto apart = [&](uint32_t a, uint32_t b) { return !avoid.Discouraged(a, b); };
+  ScopedSimulation simulation;
+  auto pairing = PairScoreGroups(std::move(groups), may_pair, apart, rand);
+
+  std::vector<Pairing> out;
+  out.reserve(pairing.paired.size() + pairing.unpaired.size());
+  IdGen gen(round_);
+  for (const auto& [a, b] : pairing.paired) {
+    PlayerRecord& ra = MutableRecord(a);
+    ra.opponents.push_back(b);
+    ra.matches_played += 1;
+    PlayerRecord& rb = MutableRecord(b);
+    rb.opponents.push_back(a);
+    rb.matches_played += 1;
+    out.push_back(Pairing{gen.next(), a, b, std::nullopt});
+  }
+  for (uint32_t p : pairing.unpaired) {
+    PlayerRecord& r = MutableRecord(p);
+    r.matches_played += 1;
+    r.byes += 1;
+    Pairing bye{gen.next(), p, std::nullopt, std::nullopt};
+    // MTR states that a Bye is considered won 2-0 in games.
+    bye.result = MatchResult{bye.id, player(p)->id(), 2, 0};
+    AddResult(bye, *bye.result);
+    out.push_back(std::move(bye));
+  }
+
+  auto& ids = rounds_[round_];
+  ids.clear();
+  for (const auto& m : out) {
+    ids.push_back(m.id);
+    matches_[m.id] = m;
+  }
+  return out;
+}
+
+Standings TournamentFork::GetStandings() const {
+  StandingsSnapshot snapshot = base_->snapshot;
+  snapshot.round = round_;
+  for (const auto& [index, record] : records_) {
+    snapshot.records[index] = record;
+  }
+  return ComputeStandings(snapshot, base_->rules);
+}
+
+}  // namespace internal
+}  // namespace tcgtc
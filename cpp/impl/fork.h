@@ -0,0 +1,122 @@
+// This file defines forks of a tournament, for "what if" previews (e.g. of
+// fixing a result, or re-pairing a round) which never touch the live event.
+//
+// A fork does not clone the Player, Match and Round objects. It is layered over
+// an immutable Base, captured from the tournament at most once per version and
+// shared by every fork of that version, and only holds its own changes: the
+// records of the players and the matches it has touched. Copying a fork copies
+// just those changes, so a fork costs O(changes) rather than O(event size).
+
+#ifndef _TCGTC_FORK_H_
+#define _TCGTC_FORK_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "cpp/definitions.h"
+#include "cpp/impl/standings.h"
+#include "cpp/match-id.h"
+#include "cpp/match-result.h"
+#include "cpp/memory-usage.h"
+#include "cpp/pairings/avoidance.h"
+#include "cpp/player-match.h"
+#include "cpp/tiebreaker.h"
+
+namespace tcgtc {
+namespace internal {
+
+class TournamentFork {
+ public:
+  struct Pairing {
+    MatchId id;
+    // Players, as indices into Base::snapshot.players.
+    uint32_t a;
+    std::optional<uint32_t> b;  // Unset for a Bye.
+    std::optional<MatchResult> result;
+  };
+
+  // The state of the tournament the fork was taken from.
+  struct Base {
+    StandingsSnapshot snapshot;
+    absl::flat_hash_map<Player::Id, uint32_t> index;
+    // Pairable players, as indices.
+    std::vector<uint32_t> active;
+    absl::flat_hash_map<MatchId, Pairing> matches;
+    // The Swiss matches of each round, in order.
+    std::map<RoundId, std::vector<MatchId>> rounds;
+    // Avoidance rules, by index.
+    absl::flat_hash_map<uint32_t, std::vector<AvoidanceRule>> avoidance;
+    uint8_t swiss_rounds = 0;
+    TieBreakRules rules = TieBreakRules::kMtr;
+
+    // In bytes (see cpp/memory-usage.h).
+    size_t BytesUsed() const;
+  };
+
+  // Takes each player's and round's lock in turn (never more than one at a
+  // time). `rounds` must all be Swiss rounds.
+  static std::shared_ptr<const Base> CaptureBase(
+      std::vector<Player> players, const std::vector<Player::Id>& active,
+      const std::vector<Round>& rounds,
+      const absl::flat_hash_map<Player::Id, std::vector<AvoidanceRule>>&
+          avoidance,
+      uint8_t swiss_rounds, TieBreakRules rules);
+
+  explicit TournamentFork(std::shared_ptr<const Base> base);
+
+  // A fork of this fork. O(changes made by this fork).
+  TournamentFork Fork() const { return *this; }
+
+  RoundId round() const { return round_; }
+  const Player& player(uint32_t index) const {
+    return base_->snapshot.players[index];
+  }
+  absl::StatusOr<uint32_t> IndexOf(Player::Id player) const;
+
+  absl::StatusOr<Pairing> GetMatch(MatchId id) const;
+  std::vector<Pairing> RoundPairings(RoundId round) const;
+
+  // Sets (or replaces) the result of a Swiss match.
+  absl::Status SetResult(const MatchResult& result);
+
+  // Discards the pairings (and any results) of the current round and pairs it
+  // again.
+  absl::StatusOr<std::vector<Pairing>> RepairRound(uint64_t seed);
+
+  // Errors if the current round is not complete.
+  absl::StatusOr<std::vector<Pairing>> PairNextRound(uint64_t seed);
+
+  // O(players), since the breakers depend on everyone's record.
+  Standings GetStandings() const;
+
+ private:
+  const PlayerRecord& Record(uint32_t index) const;
+  // Copies the record from the base on first write.
+  PlayerRecord& MutableRecord(uint32_t index);
+  const std::vector<MatchId>& RoundMatches(RoundId round) const;
+
+  void AddResult(const Pairing& m, const MatchResult& result);
+  void RemoveResult(const Pairing& m, const MatchResult& result);
+  absl::StatusOr<std::vector<Pairing>> PairRound(uint64_t seed);
+
+  std::shared_ptr<const Base> base_;
+  RoundId round_ = 0;
+
+  // Changes, relative to base_.
+  absl::flat_hash_map<uint32_t, PlayerRecord> records_;
+  // Unset for matches discarded by a re-pair.
+  absl::flat_hash_map<MatchId, std::optional<Pairing>> matches_;
+  // Rounds paired (or re-paired) by this fork.
+  std::map<RoundId, std::vector<MatchId>> rounds_;
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_FORK_H_
@@ -4,6 +4,7 @@
 
 #include "cpp/match-id.h"
 #include "cpp/match-result.h"
+#include "cpp/metrics.h"
 #include "cpp/impl/player.h"
 #include "cpp/util.h"
 
@@ -16,10 +17,35 @@ Match MatchImpl::CreateBye(Player p, MatchId id) {
 
   // Immediately commit the result of the bye back to the player's cache.
   // MTR states that a Bye is considered won 2-0 in games.
+  TimedMutexLock l(&m->mu_, MetricLock::kMatch);
   m->CommitResult(MatchResult{id, p->id(), 2});
   return m;
 }
 
+Match MatchImpl::CreateAssignedLoss(Player p, MatchId id) {
+  Match m(std::shared_ptr<MatchImpl>(
+      new MatchImpl(p, std::nullopt, id, /*assigned_loss=*/true)));
+  m->Init();
+
+  // Counted as lost 0-2 in games.
+  TimedMutexLock l(&m->mu_, MetricLock::kMatch);
+  m->CommitResult(MatchResult{id, kNoPlayer, 2});
+  return m;
+}
+
+Match MatchImpl::CreateCompacted(Player a, std::optional<Player> b,
+                                 MatchId id, bool assigned_loss,
+                                 const MatchResult& result, bool sealed) {
+  Match m(std::shared_ptr<MatchImpl>(new MatchImpl(
+      std::move(a), std::move(b), id, assigned_loss, /*compacted=*/true)));
+  // Its players already count the result, and no longer hold their matches.
+  m->InitSelfPtr();
+  TimedMutexLock l(&m->mu_, MetricLock::kMatch);
+  m->committed_result_ = result;
+  m->sealed_ = sealed;
+  return m;
+}
+
 Match MatchImpl::CreatePairing(Player a, Player b, MatchId id) {
   assert(a != b);
 
@@ -32,22 +58,31 @@ Match MatchImpl::CreatePairing(Player a, Player b, MatchId id) {
   return m;
 }
 
-MatchImpl::MatchImpl(Player a, std::optional<Player> b, MatchId id)
-  : id_(id), a_(a), b_(b) {}
+MatchImpl::MatchImpl(Player a, std::optional<Player> b, MatchId id,
+                     bool assigned_loss, bool compacted)
+  : id_(id), a_(a), b_(b), assigned_loss_(assigned_loss),
+    compacted_(compacted) {}
 
 void MatchImpl::Init() {
   InitSelfPtr();
 
-  // Add this match to the participating players as well.
-  assert(a_->AddMatch(this_match()).ok());
+  // Add this match to the participating players as well. N.B. not inside the
+  // assert, which is compiled out under NDEBUG.
+  auto added = a_->AddMatch(this_match());
+  assert(added.ok());
   if (b_.has_value()) {
-    assert((*b_)->AddMatch(this_match()).ok());
+    added = (*b_)->AddMatch(this_match());
+    assert(added.ok());
   }
 }
 
 absl::StatusOr<MatchResult> MatchImpl::confirmed_result() const {
-  absl::MutexLock l(&mu_);
-  if (committed_result_.has_value()) return *committed_result_;
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  return ConfirmedResultLocked();
+}
+
+absl::StatusOr<MatchResult> MatchImpl::ConfirmedResultLocked() const {
+  if (auto agreed = AgreedResultLocked(); agreed.has_value()) return *agreed;
 
   // TODO: Include names, match numbers, etc.
   if (!a_result_.has_value()) {
@@ -59,11 +94,29 @@ absl::StatusOr<MatchResult> MatchImpl::confirmed_result() const {
                id_.ErrorStringId());
   }
 
-  if (*a_result_ != *b_result_) {
-    return Err(a_->ErrorStringId(), " and ", (*b_)->ErrorStringId(),
-               " reported different results.");
+  return Err(a_->ErrorStringId(), " and ", (*b_)->ErrorStringId(),
+             " reported different results.");
+}
+
+std::optional<MatchResult> MatchImpl::AgreedResultLocked() const {
+  if (committed_result_.has_value()) return committed_result_;
+  if (a_result_.has_value() && b_result_.has_value() &&
+      *a_result_ == *b_result_) {
+    return a_result_;
   }
-  return *a_result_;
+  return std::nullopt;
+}
+
+MatchImpl::Results MatchImpl::results() const {
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  return Results{a_result_, b_result_, committed_result_};
+}
+
+bool MatchImpl::has_conflict() const {
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  if (committed_result_.has_value()) return false;
+  return a_result_.has_value() && b_result_.has_value() &&
+         *a_result_ != *b_result_;
 }
 
 // TODO: Consolidate these two.
@@ -82,8 +135,10 @@ absl::StatusOr<Player> MatchImpl::opponent(const Player& p) const {
   return p == a_ ? *b_ : a_;
 }
 
-absl::Status MatchImpl::PlayerReportResult(Player reporter, 
-                                           MatchResult result) {
+absl::Status MatchImpl::PlayerReportResult(
+    Player reporter, MatchResult result,
+    std::optional<MatchResult>* committed) {
+  if (committed != nullptr) committed->reset();
   // This shouldn't happen. Bye results are already committed.
   if (is_bye()) {
     return Err("Trying to report a Match result for a Bye for ", 
@@ -99,7 +154,12 @@ absl::Status MatchImpl::PlayerReportResult(Player reporter,
   // Run other validity checks on the result.
   if (auto out = CheckResultValidity(result); !out.ok()) return out;
 
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  if (retired_) return Err(id_.ErrorStringId(), " has been discarded.");
+  if (sealed_) {
+    return Err(id_.ErrorStringId(),
+               " is over; only a judge can change its result.");
+  }
   if (reporter == a_) {
     a_result_ = result;
   } else {
@@ -107,7 +167,12 @@ absl::Status MatchImpl::PlayerReportResult(Player reporter,
   }
 
   // If this report has confirmed the result, commit it back to the players.
-  if (auto conf = confirmed_result(); conf.ok()) return CommitResult(*conf);
+  if (auto conf = AgreedResultLocked(); conf.has_value()) {
+    const bool changed = committed_result_ != conf;
+    if (auto out = CommitResult(*conf); !out.ok()) return out;
+    if (committed != nullptr && changed) *committed = conf;
+    return absl::OkStatus();
+  }
 
   // The report was successful even though we didn't confirm+commit.
   return absl::OkStatus();
@@ -115,9 +180,60 @@ absl::Status MatchImpl::PlayerReportResult(Player reporter,
 
 absl::Status MatchImpl::JudgeSetResult(MatchResult result) {
   if (auto out = CheckResultValidity(result); !out.ok()) return out;
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  if (retired_) return Err(id_.ErrorStringId(), " has been discarded.");
+  if (sealed_) {
+    return Err(id_.ErrorStringId(),
+               " is over; fix its result through the tournament.");
+  }
   return CommitResult(result);
 }
 
+absl::Status MatchImpl::Retire() {
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  if (retired_) return absl::OkStatus();
+  retired_ = true;
+
+  auto me = this_match();
+  auto out = a_->RemoveMatch(me, committed_result_);
+  if (!out.ok()) return out;
+  if (b_.has_value()) {
+    out = (*b_)->RemoveMatch(me, committed_result_);
+    if (!out.ok()) return out;
+  }
+  committed_result_.reset();
+  return absl::OkStatus();
+}
+
+absl::Status MatchImpl::CheckRetire() const {
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  if (retired_) return absl::OkStatus();
+  if (sealed_) {
+    return Err(id_.ErrorStringId(), " is over; it cannot be discarded.");
+  }
+  auto check = [this](const Player& p) {
+    if (p->has_match(id_)) return absl::OkStatus();
+    return Err("Trying to remove ", id_.ErrorStringId(), " which ",
+               p->ErrorStringId(), " hasn't played.");
+  };
+  if (auto out = check(a_); !out.ok()) return out;
+  return b_.has_value() ? check(*b_) : absl::OkStatus();
+}
+
+absl::StatusOr<MatchResult> MatchImpl::Seal() {
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  if (!committed_result_.has_value()) {
+    return Err(id_.ErrorStringId(), " has no result yet.");
+  }
+  sealed_ = true;
+  return *committed_result_;
+}
+
+bool MatchImpl::sealed() const {
+  TimedMutexLock l(&mu_, MetricLock::kMatch);
+  return sealed_;
+}
+
 // TODO: This validation should perhaps exist on parse, rather than here.
 absl::Status MatchImpl::CheckResultValidity(const MatchResult& result) const {
   // Reported for the wrong match id.
@@ -127,6 +243,9 @@ absl::Status MatchImpl::CheckResultValidity(const MatchResult& result) const {
   }
 
   // Check draw validity.
+  if (!result.winner.has_value() && id_.bracket_match()) {
+    return Err("Elimination ", id_.ErrorStringId(), " cannot end in a draw.");
+  }
   if (!result.winner.has_value()) {
     // No winner implies match was drawn. Check that the wins align.
     if (result.winner_games_won == result.winner_games_lost) {
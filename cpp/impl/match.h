@@ -18,6 +18,7 @@
 #include "cpp/fraction.h"
 #include "cpp/match-id.h"
 #include "cpp/match-result.h"
+#include "cpp/memory-usage.h"
 
 namespace tcgtc {
 namespace internal {
@@ -26,9 +27,23 @@ class MatchImpl : public MemoryManagedImplementation<MatchImpl> {
  public:
   static Match CreateBye(Player p, MatchId id);
   static Match CreatePairing(Player a, Player b, MatchId id);
-
+  // E.g. for a round missed by a late entry.
+  static Match CreateAssignedLoss(Player p, MatchId id);
+  // A copy of a match from a compacted round (see cpp/impl/compact-round.h),
+  // with its committed result. Not added to its players. Sealed (see Seal())
+  // unless e.g. it is about to take a judge's fix.
+  static Match CreateCompacted(Player a, std::optional<Player> b, MatchId id,
+                               bool assigned_loss, const MatchResult& result,
+                               bool sealed = true);
+
+  // True for any match without an opponent, including assigned losses.
   bool is_bye() const { return !b_.has_value(); }
+  bool assigned_loss() const { return assigned_loss_; }
+  // True for a copy made from a compacted round.
+  bool compacted() const { return compacted_; }
   MatchId id() const { return id_; }
+  const Player& player_a() const { return a_; }
+  const std::optional<Player>& player_b() const { return b_; }
 
   // TODO: Consolidate these two.
   bool has_player(const Player& p) const;
@@ -36,18 +51,49 @@ class MatchImpl : public MemoryManagedImplementation<MatchImpl> {
   absl::StatusOr<Player> opponent(const Player& p) const;
 
   // Only returns a value if both players have reported the same result.
-  absl::StatusOr<MatchResult> confirmed_result() const;
-
-  // Returns false if the reporter or reported result is invalid.
-  absl::Status PlayerReportResult(Player reporter, MatchResult result);
+  absl::StatusOr<MatchResult> confirmed_result() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // True if both players have reported, but their reports disagree.
+  bool has_conflict() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Each player's report, and the result committed, e.g. for persisting the
+  // match.
+  struct Results {
+    std::optional<MatchResult> a;
+    std::optional<MatchResult> b;
+    std::optional<MatchResult> committed;
+  };
+  Results results() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns false if the reporter or reported result is invalid. If given,
+  // `committed` is set to the result this report committed, i.e. the one the
+  // players now agree on, unless it was already committed.
+  absl::Status PlayerReportResult(
+      Player reporter, MatchResult result,
+      std::optional<MatchResult>* committed = nullptr);
 
   // Returns false if the result is invalid. If there is already a committed
   // result, handles diffing the game scores from the previous committed
   // values.
   absl::Status JudgeSetResult(MatchResult result);
 
+  // Removes this match from its players, reversing any committed result.
+  // Further reports for it are rejected.
+  absl::Status Retire() ABSL_LOCKS_EXCLUDED(mu_);
+  // OK iff. Retire() would succeed, barring changes in between.
+  absl::Status CheckRetire() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Freezes the committed result, e.g. as its round is compacted, and returns
+  // it. Further reports and rulings for this match are rejected.
+  absl::StatusOr<MatchResult> Seal() ABSL_LOCKS_EXCLUDED(mu_);
+  bool sealed() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // A match holds nothing on the heap besides itself.
+  static size_t BytesUsed() { return sizeof(MatchImpl) + kSharedControlBytes; }
+
  private:
-  MatchImpl(Player a, std::optional<Player> b, MatchId id);
+  MatchImpl(Player a, std::optional<Player> b, MatchId id,
+            bool assigned_loss = false, bool compacted = false);
 
   // Init() and this_match() can only be called after the constructor. See
   // documentation on std::enable_shared_from_this.
@@ -60,10 +106,17 @@ class MatchImpl : public MemoryManagedImplementation<MatchImpl> {
     ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   absl::Status CheckResultValidity(const MatchResult& result) const;
+  absl::StatusOr<MatchResult> ConfirmedResultLocked() const
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // As above, without building an error (which allocates) when there is none.
+  std::optional<MatchResult> AgreedResultLocked() const
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   const MatchId id_;
   const Player a_;
   const std::optional<Player> b_;
+  const bool assigned_loss_;
+  const bool compacted_;
 
   mutable absl::Mutex mu_;
 
@@ -74,6 +127,11 @@ class MatchImpl : public MemoryManagedImplementation<MatchImpl> {
   // Set either by a judge, if the match is a bye, or when players agree on a
   std::optional<MatchResult> committed_result_ ABSL_GUARDED_BY(mu_);
 
+  // Set once the match is discarded, e.g. when its round is re-paired.
+  bool retired_ ABSL_GUARDED_BY(mu_) = false;
+  // Set once the result is final, e.g. when its round is compacted.
+  bool sealed_ ABSL_GUARDED_BY(mu_) = false;
+
   // TODO: Add a log of extensions, GRVs, etc.
 };
 
@@ -0,0 +1,62 @@
+#include "cpp/impl/pairing-board.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "cpp/player-match.h"
+
+namespace tcgtc {
+namespace internal {
+
+PairingBoard PairingBoard::Build(RoundId round,
+                                 const std::vector<Match>& matches,
+                                 const TableMap* tables) {
+  PairingBoard out;
+  out.round_ = round;
+  out.entries_.reserve(2 * matches.size());
+  for (const auto& m : matches) {
+    std::optional<TableMap::Table> table;
+    if (tables != nullptr) table = tables->ForMatch(m->id());
+
+    const Player& a = m->player_a();
+    if (m->is_bye()) {
+      out.entries_.push_back(Entry{a->id(), a->display_name(), m->id(),
+                                   std::nullopt, "", m->assigned_loss(),
+                                   std::nullopt});
+      continue;
+    }
+    const Player& b = *m->player_b();
+    out.entries_.push_back(Entry{a->id(), a->display_name(), m->id(), b->id(),
+                                 b->display_name(), false, table});
+    out.entries_.push_back(Entry{b->id(), b->display_name(), m->id(), a->id(),
+                                 a->display_name(), false, table});
+  }
+
+  std::sort(out.entries_.begin(), out.entries_.end(),
+            [](const Entry& l, const Entry& r) {
+              return std::tie(l.name, l.player) < std::tie(r.name, r.player);
+            });
+  out.index_.reserve(out.entries_.size());
+  for (uint32_t i = 0; i < out.entries_.size(); ++i) {
+    out.index_.insert({out.entries_[i].player, i});
+  }
+  return out;
+}
+
+const PairingBoard::Entry* PairingBoard::Find(Player::Id player) const {
+  if (auto it = index_.find(player); it != index_.end()) {
+    return &entries_[it->second];
+  }
+  return nullptr;
+}
+
+size_t PairingBoard::BytesUsed() const {
+  size_t bytes = HeapBytes(entries_) + HeapBytes(index_);
+  for (const Entry& entry : entries_) {
+    bytes += HeapBytes(entry.name) + HeapBytes(entry.opponent_name);
+  }
+  return bytes;
+}
+
+}  // namespace internal
+}  // namespace tcgtc
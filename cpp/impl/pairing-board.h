@@ -0,0 +1,65 @@
+// This file defines the pairing board for a round: each player's match,
+// opponent and table, sorted by name, as posted at the venue.
+//
+// At the start of a round every player asks "where am I playing?" at once, so
+// the board is built once, when the round is published, and never changes: any
+// number of readers share it without locks, and finding a player is a single
+// hash lookup rather than a search of their matches. A late entry's assigned
+// result republishes the current round's board. Earlier boards show their
+// round as it was published.
+
+#ifndef _TCGTC_PAIRING_BOARD_H_
+#define _TCGTC_PAIRING_BOARD_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "cpp/definitions.h"
+#include "cpp/impl/tables.h"
+#include "cpp/match-id.h"
+#include "cpp/memory-usage.h"
+
+namespace tcgtc {
+namespace internal {
+
+class PairingBoard {
+ public:
+  struct Entry {
+    Player::Id player = 0;
+    std::string name;
+    MatchId match;
+    // Unset for a Bye or an assigned loss.
+    std::optional<Player::Id> opponent;
+    std::string opponent_name;
+    bool assigned_loss = false;
+    std::optional<TableMap::Table> table;
+  };
+
+  // O(n log n) in the number of matches. `tables` may be null.
+  static PairingBoard Build(RoundId round, const std::vector<Match>& matches,
+                            const TableMap* tables);
+
+  RoundId round() const { return round_; }
+
+  // O(1). Null if the player has no match in this round.
+  const Entry* Find(Player::Id player) const;
+
+  // Every player in the round, by name (then id).
+  const std::vector<Entry>& entries() const { return entries_; }
+
+  // The heap storage held, in bytes (see cpp/memory-usage.h).
+  size_t BytesUsed() const;
+
+ private:
+  RoundId round_ = 0;
+  std::vector<Entry> entries_;
+  absl::flat_hash_map<Player::Id, uint32_t> index_;
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_PAIRING_BOARD_H_
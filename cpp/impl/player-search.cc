@@ -0,0 +1,207 @@
+#include "cpp/impl/player-search.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "cpp/player-match.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+// Lower-cases ASCII letters, and collapses anything else that is not a digit
+// into single spaces. Other (e.g. UTF-8) bytes are kept as they are.
+std::string Normalize(absl::string_view s) {
+  std::string out;
+  out.reserve(s.size());
+  for (unsigned char c : s) {
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    const bool keep = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                      c >= 0x80;
+    if (keep) {
+      out.push_back(c);
+    } else if (!out.empty() && out.back() != ' ') {
+      out.push_back(' ');
+    }
+  }
+  if (!out.empty() && out.back() == ' ') out.pop_back();
+  return out;
+}
+
+// The distinct trigrams of each word of a normalized string, with each word
+// padded by two spaces in front and one behind, so that short words and word
+// starts count for more.
+std::vector<uint32_t> Trigrams(const std::string& s) {
+  std::vector<uint32_t> out;
+  for (absl::string_view word : absl::StrSplit(s, ' ', absl::SkipEmpty())) {
+    const std::string padded = absl::StrCat("  ", word, " ");
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+      out.push_back(uint32_t{static_cast<unsigned char>(padded[i])} << 16 |
+                    uint32_t{static_cast<unsigned char>(padded[i + 1])} << 8 |
+                    uint32_t{static_cast<unsigned char>(padded[i + 2])});
+    }
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return out;
+}
+}  // namespace
+
+bool PlayerSearch::Add(const Player& p) {
+  std::vector<std::string> names;
+  for (const std::string& name :
+       {p->first_name(), p->last_name(), p->username(),
+        absl::StrCat(p->first_name(), " ", p->last_name())}) {
+    std::string n = Normalize(name);
+    if (n.empty() || std::find(names.begin(), names.end(), n) != names.end()) {
+      continue;
+    }
+    names.push_back(std::move(n));
+  }
+
+  absl::MutexLock l(&mu_);
+  const uint32_t slot = slots_.size();
+  if (!by_id_.insert({p->id(), slot}).second) return false;
+  slots_.push_back({p->id(), p->display_name(), true});
+  string_bytes_ += HeapBytes(slots_.back().display_name);
+
+  for (const std::string& name : names) {
+    // Later words are prefixes too, e.g. "berg" for "van den berg".
+    for (absl::string_view word :
+         absl::StrSplit(name, ' ', absl::SkipEmpty())) {
+      if (auto [it, added] = prefixes_.insert({std::string(word), slot});
+          added) {
+        string_bytes_ += HeapBytes(it->first);
+      }
+    }
+    if (auto [it, added] = prefixes_.insert({name, slot}); added) {
+      string_bytes_ += HeapBytes(it->first);
+    }
+
+    auto [it, added] = name_ids_.insert({name, names_.size()});
+    if (added) {
+      string_bytes_ += HeapBytes(it->first);
+      const std::vector<uint32_t> trigrams = Trigrams(name);
+      names_.push_back({static_cast<uint16_t>(trigrams.size()), {}});
+      for (uint32_t t : trigrams) postings_[t].push_back(it->second);
+    }
+    names_[it->second].slots.push_back(slot);
+  }
+  return true;
+}
+
+void PlayerSearch::SetActive(Player::Id p, bool active) {
+  absl::MutexLock l(&mu_);
+  if (auto it = by_id_.find(p); it != by_id_.end()) {
+    slots_[it->second].active = active;
+  }
+}
+
+size_t PlayerSearch::size() const {
+  absl::ReaderMutexLock l(&mu_);
+  return slots_.size();
+}
+
+size_t PlayerSearch::BytesUsed() const {
+  absl::ReaderMutexLock l(&mu_);
+  size_t bytes = string_bytes_ + HeapBytes(slots_) + HeapBytes(by_id_) +
+                 HeapBytes(prefixes_) + HeapBytes(names_) +
+                 HeapBytes(name_ids_) + HeapBytes(postings_);
+  for (const Name& name : names_) bytes += HeapBytes(name.slots);
+  for (const auto& [trigram, names] : postings_) bytes += HeapBytes(names);
+  return bytes;
+}
+
+PlayerSearch::Hit PlayerSearch::ToHit(uint32_t slot, double score) const {
+  const Slot& s = slots_[slot];
+  return Hit{s.id, s.display_name, s.active, score};
+}
+
+std::vector<PlayerSearch::Hit> PlayerSearch::Prefix(absl::string_view query,
+                                                    size_t limit) const {
+  const std::string key = Normalize(query);
+  absl::ReaderMutexLock l(&mu_);
+  return PrefixLocked(key, limit);
+}
+
+std::vector<PlayerSearch::Hit> PlayerSearch::PrefixLocked(
+    const std::string& key, size_t limit) const {
+  std::vector<Hit> out;
+  if (key.empty()) return out;
+  absl::flat_hash_set<uint32_t> seen;
+  for (auto it = prefixes_.lower_bound({key, 0});
+       it != prefixes_.end() && out.size() < limit; ++it) {
+    if (it->first.compare(0, key.size(), key) != 0) break;
+    if (seen.insert(it->second).second) out.push_back(ToHit(it->second, 1));
+  }
+  return out;
+}
+
+std::vector<PlayerSearch::Hit> PlayerSearch::Fuzzy(absl::string_view query,
+                                                   size_t limit) const {
+  const std::string key = Normalize(query);
+  absl::ReaderMutexLock l(&mu_);
+  return FuzzyLocked(key, limit);
+}
+
+std::vector<PlayerSearch::Hit> PlayerSearch::FuzzyLocked(
+    const std::string& key, size_t limit) const {
+  std::vector<Hit> out;
+  const std::vector<uint32_t> trigrams = Trigrams(key);
+  if (trigrams.empty() || limit == 0) return out;
+
+  // Trigrams each name shares with the query. Common trigrams (e.g. " s")
+  // have long posting lists, so count in an array rather than a map.
+  std::vector<uint16_t> shared(names_.size(), 0);
+  std::vector<uint32_t> touched;
+  for (uint32_t t : trigrams) {
+    auto it = postings_.find(t);
+    if (it == postings_.end()) continue;
+    for (uint32_t name : it->second) {
+      if (shared[name]++ == 0) touched.push_back(name);
+    }
+  }
+
+  std::vector<std::pair<double, uint32_t>> scored;
+  for (uint32_t name : touched) {
+    const uint16_t count = shared[name];
+    const double score = static_cast<double>(count) /
+                         (trigrams.size() + names_[name].trigrams - count);
+    if (score >= kMinSimilarity) scored.push_back({score, name});
+  }
+  std::sort(scored.begin(), scored.end(), [](const auto& l, const auto& r) {
+    return std::tie(r.first, l.second) < std::tie(l.first, r.second);
+  });
+
+  // A player scores as their most similar name, i.e. the first one found.
+  // Only as many players as are asked for are ever looked at.
+  absl::flat_hash_set<uint32_t> seen;
+  for (const auto& [score, name] : scored) {
+    for (uint32_t slot : names_[name].slots) {
+      if (out.size() >= limit) return out;
+      if (seen.insert(slot).second) out.push_back(ToHit(slot, score));
+    }
+  }
+  return out;
+}
+
+std::vector<PlayerSearch::Hit> PlayerSearch::Search(absl::string_view query,
+                                                    size_t limit) const {
+  const std::string key = Normalize(query);
+  absl::ReaderMutexLock l(&mu_);
+  std::vector<Hit> out = PrefixLocked(key, limit);
+  if (out.size() >= limit) return out;
+
+  absl::flat_hash_set<Player::Id> seen;
+  for (const Hit& h : out) seen.insert(h.player);
+  for (Hit& h : FuzzyLocked(key, limit + out.size())) {
+    if (out.size() >= limit) break;
+    if (!seen.contains(h.player)) out.push_back(std::move(h));
+  }
+  return out;
+}
+
+}  // namespace internal
+}  // namespace tcgtc
@@ -0,0 +1,110 @@
+// This file defines the index judges and scorekeepers use to look players up by
+// a partial name or username:
+//   - Prefix search: "smi" finds Smith, Smithers and username smiley, from a
+//     sorted set of each player's (lower-cased) names.
+//   - Fuzzy search: "smyth" finds Smith, by the trigrams (runs of three
+//     characters) they share.
+//
+// Entries and drops update the index in O(log n), so it is never rebuilt, and
+// dropped players stay searchable. It is internally synchronized, so queries
+// never wait on the tournament, only on an entry or drop in progress.
+
+#ifndef _TCGTC_PLAYER_SEARCH_H_
+#define _TCGTC_PLAYER_SEARCH_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "cpp/definitions.h"
+#include "cpp/memory-usage.h"
+
+namespace tcgtc {
+namespace internal {
+
+class PlayerSearch {
+ public:
+  struct Hit {
+    Player::Id player = 0;
+    std::string display_name;
+    bool active = true;
+    // 1 for a prefix match, otherwise the trigram similarity, in (0, 1].
+    double score = 0;
+  };
+
+  // Fuzzy hits must share at least this fraction of their trigrams with the
+  // query (Jaccard similarity) against one of the player's names.
+  static constexpr double kMinSimilarity = 0.3;
+
+  // Indexes the player's first and last names, full name and username. Returns
+  // false if the player is already present.
+  bool Add(const Player& p) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Marks the player as dropped (or not). Dropped players are still found.
+  void SetActive(Player::Id p, bool active) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Players with a name or username starting with `query`, ignoring case and
+  // punctuation, in name order. O(log n + hits).
+  std::vector<Hit> Prefix(absl::string_view query, size_t limit) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Players with a name or username similar to `query`, best first (then in
+  // the order they entered). Linear in the number of distinct names sharing a
+  // trigram with the query.
+  std::vector<Hit> Fuzzy(absl::string_view query, size_t limit) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Prefix hits, then fuzzy hits (if there is room).
+  std::vector<Hit> Search(absl::string_view query, size_t limit) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  size_t size() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The heap storage held, in bytes (see cpp/memory-usage.h).
+  size_t BytesUsed() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Slot {
+    Player::Id id = 0;
+    std::string display_name;
+    bool active = true;
+  };
+  // A distinct name, for fuzzy search. Names repeat (there are many Smiths),
+  // so a query scores each once rather than once per player.
+  struct Name {
+    uint16_t trigrams = 0;
+    std::vector<uint32_t> slots;
+  };
+
+  Hit ToHit(uint32_t slot, double score) const ABSL_SHARED_LOCKS_REQUIRED(mu_);
+  std::vector<Hit> PrefixLocked(const std::string& key, size_t limit) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+  std::vector<Hit> FuzzyLocked(const std::string& key, size_t limit) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+  std::vector<Slot> slots_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<Player::Id, uint32_t> by_id_ ABSL_GUARDED_BY(mu_);
+  // (normalized name, slot), for each of a slot's distinct names.
+  absl::btree_set<std::pair<std::string, uint32_t>> prefixes_
+      ABSL_GUARDED_BY(mu_);
+  std::vector<Name> names_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, uint32_t> name_ids_ ABSL_GUARDED_BY(mu_);
+  // Trigram to the names containing it, in the order they were added.
+  absl::flat_hash_map<uint32_t, std::vector<uint32_t>> postings_
+      ABSL_GUARDED_BY(mu_);
+  // The heap storage of every string above, which never changes once added, so
+  // that BytesUsed() need not walk them.
+  size_t string_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_PLAYER_SEARCH_H_
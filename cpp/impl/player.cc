@@ -1,10 +1,12 @@
 #include "player.h"
 
+#include <algorithm>
 #include <cstdint>
 
 #include "cpp/impl/match.h"
 #include "cpp/match-id.h"
 #include "cpp/match-result.h"
+#include "cpp/metrics.h"
 #include "cpp/util.h"
 
 namespace tcgtc {
@@ -31,8 +33,9 @@ Player PlayerImpl::CreatePlayer(Options opts) {
 
 absl::Status PlayerImpl::CommitResult(const MatchResult& result,
                               const std::optional<MatchResult>& prev) {
-  absl::MutexLock l(&mu_);
-  if (matches_.find(result.id) == matches_.end()) {
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
+  if (matches_.find(result.id) == matches_.end() &&
+      result.id.round > compacted_through_) {
     return Err("Trying to commit result for ", result.id.ErrorStringId(),
                " ", ErrorStringId()," hasn't played.");
   }
@@ -56,7 +59,7 @@ absl::Status PlayerImpl::CommitResult(const MatchResult& result,
 }
 
 absl::Status PlayerImpl::AddMatch(Match m) {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
   auto me = this_player();
   if (!m->has_player(me)) {
     return Err("Trying to add ", m->id().ErrorStringId(), " in which ",
@@ -71,46 +74,84 @@ absl::Status PlayerImpl::AddMatch(Match m) {
   return absl::OkStatus();
 }
 
+absl::Status PlayerImpl::RemoveMatch(
+    const Match& m, const std::optional<MatchResult>& committed) {
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
+  auto me = this_player();
+  if (matches_.erase(m->id()) == 0) {
+    return Err("Trying to remove ", m->id().ErrorStringId(), " which ",
+               ErrorStringId(), " hasn't played.");
+  }
+  if (committed.has_value()) {
+    games_played_ -= committed->games_played();
+    game_points_ -= committed->game_points(id_);
+    match_points_ -= committed->match_points(id_);
+  }
+
+  // Only forget the opponent if no other match was against them.
+  if (m->is_bye()) return absl::OkStatus();
+  auto opp = m->opponent(me);
+  if (!opp.ok()) return opp.status();
+  for (const auto& [id, other] : matches_) {
+    if (other->has_player(*opp)) return absl::OkStatus();
+  }
+  opponents_.erase((*opp)->id());
+  return absl::OkStatus();
+}
+
 bool PlayerImpl::has_played_opp(const Player& p) const {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
   return opponents_.find(p->id()) != opponents_.end();
 }
 
-TieBreakInfo PlayerImpl::ComputeBreakers() const {
-  absl::MutexLock l(&mu_);
+bool PlayerImpl::has_match(MatchId id) const {
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
+  return matches_.count(id) > 0;
+}
+
+absl::Status PlayerImpl::CompactMatch(const Match& m) {
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
+  if (matches_.erase(m->id()) == 0) {
+    return Err("Trying to compact ", m->id().ErrorStringId(), " which ",
+               ErrorStringId(), " hasn't played.");
+  }
+  ++compacted_matches_;
+  compacted_through_ = std::max(compacted_through_, m->id().round);
+  return absl::OkStatus();
+}
+
+void PlayerImpl::AddMemoryUsage(MemoryUsage* usage) const {
+  usage->players += sizeof(PlayerImpl) + kSharedControlBytes;
+  usage->names += HeapBytes(first_name_) + HeapBytes(last_name_) +
+                  HeapBytes(username_) + HeapBytes(display_name_);
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
+  usage->player_matches += HeapBytes(opponents_) + HeapBytes(matches_);
+}
+
+PlayerRecord PlayerImpl::GetRecord(
+    const absl::flat_hash_map<Player::Id, uint32_t>& index) const {
+  TimedMutexLock l(&mu_, MetricLock::kPlayer);
   auto me = this_player();
-  Fraction omwp_sum(0);
-  Fraction ogwp_sum(0);
-  uint16_t num_opps = 0;
+  PlayerRecord out;
+  out.match_points = match_points_;
+  out.game_points = game_points_;
+  out.games_played = games_played_;
+  out.matches_played = matches_.size() + compacted_matches_;
+  out.compacted_through = compacted_through_;
+  out.opponents.reserve(out.matches_played);
   for (const auto& [id, m] : matches_) {
-    assert(id == m->id());
-
     // Elimination rounds are not part of tie-breakers.
     if (id.bracket_match()) continue;
-
-    // Have an opponent iff. this match isn't a bye, so include it in tie-break.
+    if (m->is_bye()) {
+      if (!m->assigned_loss()) ++out.byes;
+      continue;
+    }
     if (auto opp = m->opponent(me); opp.ok()) {
-      // mwp() and gwp() already apply the MTR Bound of 1/3 (33.3%) minimum.
-      omwp_sum += (*opp)->mwp();
-      ogwp_sum += (*opp)->gwp();
-      ++num_opps;
+      if (auto it = index.find((*opp)->id()); it != index.end()) {
+        out.opponents.push_back(it->second);
+      }
     }
   }
-  // Return a default value of 1.
-  // TODO: Make sure this aligns with MTR. Probably just an R1/2 corner case.
-  TieBreakInfo out;
-  out.match_points = match_points_;
-  if (num_opps == 0) {
-    static const Fraction kOne(1);
-    out.opp_mwp = kOne;
-    out.gwp = kOne;
-    out.opp_gwp = kOne;
-  } else {
-    Fraction divisor(num_opps);
-    out.opp_mwp = omwp_sum / divisor;
-    out.gwp = gwp();
-    out.opp_gwp = ogwp_sum / divisor;
-  }
   return out;
 }
 
@@ -18,12 +18,31 @@
 #include "cpp/fraction.h"
 #include "cpp/match-id.h"
 #include "cpp/match-result.h"
+#include "cpp/memory-usage.h"
 #include "cpp/tiebreaker.h"
 #include "cpp/util.h"
 
 namespace tcgtc {
 namespace internal {
 
+// A player's results as of some point in time. Opponents are indices into some
+// enclosing collection of players rather than Players, so that computing
+// breakers from records never needs to touch another player.
+struct PlayerRecord {
+  uint16_t match_points = 0;
+  uint16_t game_points = 0;
+  uint16_t games_played = 0;
+  uint16_t matches_played = 0;
+  // Swiss byes received.
+  uint16_t byes = 0;
+  // Swiss (non-bye) opponents.
+  std::vector<uint32_t> opponents;
+  // Opponents and byes from rounds up to this one (if any) are left out: the
+  // player no longer holds those matches, which are kept by their (compacted)
+  // rounds instead. See CompactRound::AddToRecords.
+  RoundId compacted_through = 0;
+};
+
 class PlayerImpl : public MemoryManagedImplementation<PlayerImpl> {
  public:
 
@@ -40,31 +59,53 @@ class PlayerImpl : public MemoryManagedImplementation<PlayerImpl> {
   const std::string& last_name() const { return last_name_; }
   const std::string& first_name() const { return first_name_; }
   const std::string& username() const { return username_; }
+  const std::string& display_name() const { return display_name_; }
 
   std::string ErrorStringId() const {
     return absl::StrCat("Player (", display_name_, ")");
   }
 
   bool has_played_opp(const Player& p) const  ABSL_LOCKS_EXCLUDED(mu_);
+  // True if the match is held here, i.e. has not been removed or compacted.
+  bool has_match(MatchId id) const ABSL_LOCKS_EXCLUDED(mu_);
 
   uint16_t match_points() const { return match_points_; }
   Fraction mwp() const { 
-    return Fraction(match_points_, 3 * matches_.size()).ApplyMtrBound();
+    return Fraction(match_points_, 3 * (matches_.size() + compacted_matches_))
+        .ApplyMtrBound();
   }
   Fraction gwp() const { 
     return Fraction(game_points_, 3 * games_played_).ApplyMtrBound();
   }
 
-  TieBreakInfo ComputeBreakers() const ABSL_LOCKS_EXCLUDED(mu_);
+  // Copies this player's cached results. Opponents are translated via `index`
+  // and skipped if not present there.
+  PlayerRecord GetRecord(
+      const absl::flat_hash_map<Player::Id, uint32_t>& index) const
+    ABSL_LOCKS_EXCLUDED(mu_);
 
   // Commit a result, and if there is a previous result for that match, erase
-  // that from the cache.
+  // that from the cache. The match may be one already compacted.
   absl::Status CommitResult(const MatchResult& result,
                             const std::optional<MatchResult>& prev)
     ABSL_LOCKS_EXCLUDED(mu_);
 
   absl::Status AddMatch(Match m) ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Removes a match, and reverses its committed result (if any) from the
+  // cache. The inverse of AddMatch + CommitResult.
+  absl::Status RemoveMatch(const Match& m,
+                           const std::optional<MatchResult>& committed)
+    ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Lets go of a match whose round has been compacted, which still counts
+  // towards the results cached here.
+  absl::Status CompactMatch(const Match& m) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Adds this player, their names and their maps of matches and opponents to
+  // `usage`. The matches themselves belong to the tournament.
+  void AddMemoryUsage(MemoryUsage* usage) const ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
   explicit PlayerImpl(const Options& opts);
 
@@ -88,6 +129,10 @@ class PlayerImpl : public MemoryManagedImplementation<PlayerImpl> {
 
   absl::flat_hash_map<Player::Id, Player> opponents_ ABSL_GUARDED_BY(mu_);
   std::map<MatchId, Match> matches_ ABSL_GUARDED_BY(mu_);
+  // Matches let go of by CompactMatch(), all in rounds up to
+  // compacted_through_.
+  uint16_t compacted_matches_ ABSL_GUARDED_BY(mu_) = 0;
+  RoundId compacted_through_ ABSL_GUARDED_BY(mu_) = 0;
 
   // TODO: Add a log of GRVs, warnings, etc.
 };
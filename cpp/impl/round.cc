@@ -1,10 +1,13 @@
 #include "cpp/impl/round.h"
 
 #include <algorithm>
+#include <chrono>
 
 #include "cpp/match-id.h"
 #include "cpp/match-result.h"
+#include "cpp/metrics.h"
 #include "cpp/player-match.h"
+#include "cpp/trace.h"
 #include "cpp/impl/tournament.h"
 #include "cpp/pairings/isomorphism.h"
 #include "cpp/util.h"
@@ -24,13 +27,36 @@ Round RoundImpl::CreateRound(const Options& opts) {
   return Round(std::shared_ptr<RoundImpl>(new RoundImpl(opts)));
 }
 
+Round RoundImpl::RestoreRound(const Options& opts, std::vector<Match> matches) {
+  Round r = CreateRound(opts);
+  r->InitSelfPtr();
+  {
+    TimedMutexLock l(&r->mu_, MetricLock::kRound);
+    for (Match& m : matches) {
+      const MatchId id = m->id();
+      r->last_number_ = std::max(r->last_number_, id.number);
+      auto& dest = m->results().committed.has_value() ? r->reported_matches_
+                                                      : r->outstanding_matches_;
+      dest.insert({id, std::move(m)});
+    }
+    r->outstanding_count_.fetch_add(r->outstanding_matches_.size(),
+                                    std::memory_order_acq_rel);
+    r->paired_ = true;
+  }
+  r->ReleaseOutstanding();
+  return r;
+}
+
 // Initializes this round, including generating pairings.
 absl::Status RoundImpl::Init() {
   InitSelfPtr();
 
-  if (MatchId::IsSwiss(id_)) return GenerateSwissPairings();
+  auto out = MatchId::IsSwiss(id_) ? GenerateSwissPairings()
+                                   : GenerateBracketPairings();
+  if (!out.ok()) return out;
 
-  // TODO: Provide the ability to pair brackets correctly.
+  // Pairings are published; release the count held while pairing.
+  ReleaseOutstanding();
   return absl::OkStatus();
 }
 
@@ -39,13 +65,137 @@ std::string RoundImpl::ErrorStringId() const {
 }
 
 absl::Status RoundImpl::CommitMatchResult(Match m) {
-  // TODO: Fill this out.
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  auto it = outstanding_matches_.find(m->id());
+  if (it == outstanding_matches_.end()) {
+    // A result may be re-committed, e.g. when a player re-reports. A judge's
+    // fix which raced the round being compacted was sealed into the block.
+    if (reported_matches_.contains(m->id())) return absl::OkStatus();
+    if (auto compact = this->compact();
+        compact != nullptr && compact->Find(m->id().number).has_value()) {
+      return absl::OkStatus();
+    }
+    return Err(m->id().ErrorStringId(), " is not in ", ErrorStringId());
+  }
+  reported_matches_.insert(*it);
+  outstanding_matches_.erase(it);
+  l.Release();
+
+  ReleaseOutstanding();
   return absl::OkStatus();
 }
 
+void RoundImpl::ReleaseOutstanding() {
+  if (outstanding_count_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+  std::vector<std::function<void(Round)>> callbacks;
+  {
+    TimedMutexLock l(&mu_, MetricLock::kRound);
+    complete_.Notify();
+    callbacks.swap(on_complete_);
+  }
+  for (auto& cb : callbacks) cb(this_round());
+}
+
+void RoundImpl::OnComplete(std::function<void(Round)> cb) {
+  {
+    TimedMutexLock l(&mu_, MetricLock::kRound);
+    if (!complete_.HasBeenNotified()) {
+      on_complete_.push_back(std::move(cb));
+      return;
+    }
+  }
+  cb(this_round());
+}
+
+void RoundImpl::DropOnComplete() {
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  on_complete_.clear();
+}
+
 absl::Status RoundImpl::JudgeSetResult(Match m) {
-  // TODO: Fill this out.
-  return absl::OkStatus();
+  // A judge may both set the initial result and fix an already committed one.
+  return CommitMatchResult(std::move(m));
+}
+
+bool RoundImpl::paired() const {
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  return paired_;
+}
+
+absl::StatusOr<Match> RoundImpl::AddAssignedResult(Player p, bool bye) {
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  if (!paired_) return Err(ErrorStringId(), " is still being paired.");
+  MatchId id{id_, ++last_number_};
+  Match m = bye ? Match::Impl::CreateBye(p, id)
+                : Match::Impl::CreateAssignedLoss(p, id);
+  reported_matches_.insert({id, m});
+  return m;
+}
+
+std::vector<Match> RoundImpl::Matches() const {
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  std::vector<Match> out;
+  auto compact = this->compact();
+  out.reserve(outstanding_matches_.size() + reported_matches_.size() +
+              (compact != nullptr ? compact->size() : 0));
+  for (const auto& [id, m] : outstanding_matches_) out.push_back(m);
+  for (const auto& [id, m] : reported_matches_) out.push_back(m);
+  l.Release();
+
+  if (compact != nullptr) {
+    for (Match& m : compact->Matches()) out.push_back(std::move(m));
+  }
+  return out;
+}
+
+absl::StatusOr<std::vector<Match>> RoundImpl::Compact(
+    std::shared_ptr<const std::vector<Player>> roster) {
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  if (compact() != nullptr) {
+    return Err(ErrorStringId(), " has already been compacted.");
+  }
+  if (!paired_ || !outstanding_matches_.empty()) {
+    return Err(ErrorStringId(), " is not complete!");
+  }
+  std::vector<Match> matches;
+  matches.reserve(reported_matches_.size());
+  for (const auto& [id, m] : reported_matches_) matches.push_back(m);
+  auto block = CompactRound::Build(id_, matches, std::move(roster));
+  if (!block.ok()) return block.status();
+
+  // Publish the block before letting go of the matches, so that readers always
+  // find each match in one or the other.
+  std::atomic_store(&compact_, *std::move(block));
+  absl::flat_hash_map<MatchId, Match>().swap(reported_matches_);
+  return matches;
+}
+
+size_t RoundImpl::BytesUsed() const {
+  size_t bytes = sizeof(RoundImpl) + kSharedControlBytes;
+  if (auto tables = this->tables(); tables != nullptr) {
+    bytes += sizeof(TableMap) + tables->BytesUsed();
+  }
+  if (auto board = this->board(); board != nullptr) {
+    bytes += sizeof(PairingBoard) + board->BytesUsed();
+  }
+  if (auto diagnostics = this->diagnostics(); diagnostics != nullptr) {
+    bytes += sizeof(PairingDiagnostics) + HeapBytes(diagnostics->chunks);
+    for (const ChunkDiagnostics& chunk : diagnostics->chunks) {
+      bytes += HeapBytes(chunk.degrees);
+    }
+  }
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  return bytes + HeapBytes(outstanding_matches_) +
+         HeapBytes(reported_matches_) + HeapBytes(on_complete_);
+}
+
+std::vector<Match> RoundImpl::OutstandingMatches() const {
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  std::vector<Match> out;
+  out.reserve(outstanding_matches_.size());
+  for (const auto& [id, m] : outstanding_matches_) out.push_back(m);
+  return out;
 }
 
 // TODO: Look into benchmarking this function eventually.
@@ -56,24 +206,41 @@ absl::Status RoundImpl::GenerateSwissPairings() {
   Tournament parent = *std::move(p);
   auto players = parent->ActivePlayers();
 
-  PartialPairing final;
-  for (auto it = players.rbegin(); it != players.rend(); ++it) {
-    auto& current = it->second;
-
-    // Collect any unpaired players from the last attempt.
-    for (auto& p : final.unpaired) current.push_back(std::move(p));
-    auto tmp = PairChunk(current, parent->rand());
-
-    // Collect the pairings for this chunk.
-    for (auto& pair : tmp.paired) final.paired.push_back(std::move(pair));
-    final.unpaired.swap(tmp.unpaired);
-  }
+  // Use the pairings precomputed while the last round finished, if any.
+  const auto start = std::chrono::steady_clock::now();
+  auto speculative = parent->TakeSpeculativePairing(players);
+  TraceSpan pairing_span("pair players");
+  pairing_span.AddArg("speculative", speculative.has_value());
+  PairingDiagnostics diagnostics;
+  diagnostics.speculative = speculative.has_value();
+  PartialPairing final = speculative.has_value()
+      ? *std::move(speculative)
+      : parent->PairActivePlayers(id_, &diagnostics);
+  pairing_span.AddArg("paired", 2 * final.paired.size());
+  pairing_span.AddArg("unpaired", final.unpaired.size());
+  diagnostics.byes = final.unpaired.size();
+  diagnostics.time = std::chrono::steady_clock::now() - start;
+  Metrics::Global().RecordPairing(diagnostics);
+  std::atomic_store(
+      &diagnostics_,
+      std::make_shared<const PairingDiagnostics>(std::move(diagnostics)));
   assert(std::all_of(final.paired.begin(), final.paired.end(), [](auto p){
      return ValidPairing(p);
   }));
-  assert(final.unpaired.size() <= 1);
+  // At most one player gets a Bye. Anyone else left unpaired may play no one
+  // remaining (e.g. through hard avoidance rules), which is for a judge to
+  // sort out before the round can be paired.
+  if (final.unpaired.size() > 1) {
+    return Err(ErrorStringId(), " cannot be paired: ", final.unpaired.size(),
+               " players have no one left they may play.");
+  }
 
-  absl::MutexLock l(&mu_);
+  TraceSpan span("create matches");
+  span.AddArg("matches", final.paired.size() + final.unpaired.size());
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  // Sized up front, so that committing a result never grows the maps.
+  outstanding_matches_.reserve(final.paired.size());
+  reported_matches_.reserve(final.paired.size() + final.unpaired.size());
   IdGen gen(id_);
   for (const auto& p : final.paired) {
     MatchId id = gen.next();
@@ -81,11 +248,38 @@ absl::Status RoundImpl::GenerateSwissPairings() {
     const auto& r = p.second;
     outstanding_matches_.insert({id, Match::Impl::CreatePairing(l, r, id)});
   }
+  outstanding_count_.fetch_add(outstanding_matches_.size(),
+                               std::memory_order_acq_rel);
   for (auto& p :  final.unpaired) {
     MatchId id = gen.next();
     reported_matches_.insert({id, Match::Impl::CreateBye(p, id)});
   }
+  last_number_ = final.paired.size() + final.unpaired.size();
+  paired_ = true;
+
+  return absl::OkStatus();
+}
 
+absl::Status RoundImpl::GenerateBracketPairings() {
+  auto p = parent_.Lock();
+  if (!p.ok()) return p.status();
+
+  auto pairings = (*p)->BracketPairings(id_);
+  if (!pairings.ok()) return pairings.status();
+
+  TimedMutexLock l(&mu_, MetricLock::kRound);
+  outstanding_matches_.reserve(pairings->size());
+  reported_matches_.reserve(pairings->size());
+  for (const auto& pairing : *pairings) {
+    // Number by bracket node, so that results advance in O(1).
+    MatchId id{id_, static_cast<uint32_t>(pairing.node) + 1};
+    outstanding_matches_.insert(
+        {id, Match::Impl::CreatePairing(pairing.a, pairing.b, id)});
+    last_number_ = std::max<uint32_t>(last_number_, id.number);
+  }
+  outstanding_count_.fetch_add(outstanding_matches_.size(),
+                               std::memory_order_acq_rel);
+  paired_ = true;
   return absl::OkStatus();
 }
 
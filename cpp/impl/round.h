@@ -1,7 +1,9 @@
 #ifndef _TCGTC_ROUND_H_
 #define _TCGTC_ROUND_H_
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -13,10 +15,17 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "cpp/container-class.h"
 #include "cpp/definitions.h"
 #include "cpp/fraction.h"
+#include "cpp/impl/compact-round.h"
+#include "cpp/impl/pairing-board.h"
+#include "cpp/impl/tables.h"
 #include "cpp/match-id.h"
+#include "cpp/memory-usage.h"
+#include "cpp/pairings/diagnostics.h"
 #include "cpp/tiebreaker.h"
 #include "cpp/util.h"
 
@@ -31,32 +40,130 @@ class RoundImpl : public MemoryManagedImplementation<RoundImpl> {
   };
   static Round CreateRound(const Options& opts);
 
+  // A round paired earlier, e.g. of a tournament reloaded from a snapshot.
+  // Matches with a committed result count as reported, and the rest as
+  // outstanding.
+  static Round RestoreRound(const Options& opts, std::vector<Match> matches);
+
   // Initializes this round, including generating pairings.
   absl::Status Init();
 
   std::string ErrorStringId() const;
+  Round::Id id() const { return id_; }
+
+  // True once Init() has generated this round's pairings.
+  bool paired() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Moves a match with a committed result out of the outstanding set.
+  absl::Status CommitMatchResult(Match m) ABSL_LOCKS_EXCLUDED(mu_);
+  absl::Status JudgeSetResult(Match m) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Gives a late entry a bye or an assigned loss for this round.
+  absl::StatusOr<Match> AddAssignedResult(Player p, bool bye)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Including copies of any compacted matches.
+  std::vector<Match> Matches() const ABSL_LOCKS_EXCLUDED(mu_);
+  std::vector<Match> OutstandingMatches() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Moves the matches of a complete round into a CompactRound, numbering
+  // players by `roster`, and returns the (now sealed) matches let go of. Late
+  // entries' results added afterwards stay as they are.
+  absl::StatusOr<std::vector<Match>> Compact(
+      std::shared_ptr<const std::vector<Player>> roster)
+      ABSL_LOCKS_EXCLUDED(mu_);
 
-  absl::Status CommitMatchResult(Match m);
-  absl::Status JudgeSetResult(Match m);
+  // Null until the round is compacted. Lock-free.
+  std::shared_ptr<const CompactRound> compact() const {
+    return std::atomic_load(&compact_);
+  }
 
+  // Lock-free.
   bool RoundComplete() const {
-    absl::MutexLock l(&mu_);
-    return outstanding_matches_.empty();
+    return outstanding_count_.load(std::memory_order_acquire) == 0;
+  }
+  uint32_t outstanding_count() const {
+    return outstanding_count_.load(std::memory_order_acquire);
+  }
+
+  // Blocks until the last match of this round has a committed result, or the
+  // timeout expires. Returns true if the round is complete.
+  bool AwaitCompletion(absl::Duration timeout) const {
+    return complete_.WaitForNotificationWithTimeout(timeout);
   }
+
+  // Runs `cb` exactly once, on the thread which commits the last result of the
+  // round, or immediately if the round is already complete. Unless dropped
+  // first: see below.
+  void OnComplete(std::function<void(Round)> cb) ABSL_LOCKS_EXCLUDED(mu_);
+  // Drops the callbacks which have not run, e.g. once the round is replaced,
+  // so that a result committed to it afterwards fires none of them.
+  void DropOnComplete() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The seating for this round, or null until it has been assigned. Lock-free.
+  std::shared_ptr<const TableMap> tables() const {
+    return std::atomic_load(&tables_);
+  }
+  void SetTables(TableMap tables) {
+    std::atomic_store(&tables_,
+                      std::make_shared<const TableMap>(std::move(tables)));
+  }
+
+  // Who plays whom, and where, by name. Null until the round is published.
+  // Lock-free.
+  std::shared_ptr<const PairingBoard> board() const {
+    return std::atomic_load(&board_);
+  }
+  void SetBoard(std::shared_ptr<const PairingBoard> board) {
+    std::atomic_store(&board_, std::move(board));
+  }
+
+  // How the Swiss pairing for this round went. Null until the round is paired,
+  // and for elimination rounds. Lock-free.
+  std::shared_ptr<const PairingDiagnostics> diagnostics() const {
+    return std::atomic_load(&diagnostics_);
+  }
+
+  // This round, its sets of matches, seating, board and diagnostics, in bytes
+  // (see cpp/memory-usage.h). The matches themselves, compacted or not, are
+  // counted by the tournament.
+  size_t BytesUsed() const ABSL_LOCKS_EXCLUDED(mu_);
    
  private:
   explicit RoundImpl(const Options& opts);
   Round this_round() const { return Round(self_copy()); }
 
   absl::Status GenerateSwissPairings();
+  absl::Status GenerateBracketPairings();
+
+  // Releases one outstanding count, firing the completion callbacks if it was
+  // the last one.
+  void ReleaseOutstanding() ABSL_LOCKS_EXCLUDED(mu_);
 
   const Round::Id id_;
   const Tournament::View parent_;
 
+  // Only accessed through std::atomic_load/std::atomic_store.
+  std::shared_ptr<const TableMap> tables_;
+  std::shared_ptr<const PairingBoard> board_;
+  std::shared_ptr<const PairingDiagnostics> diagnostics_;
+  // Set (under mu_) once the round is compacted.
+  std::shared_ptr<const CompactRound> compact_;
+
   mutable absl::Mutex mu_;
 
   absl::flat_hash_map<MatchId, Match> outstanding_matches_ ABSL_GUARDED_BY(mu_);
   absl::flat_hash_map<MatchId, Match> reported_matches_ ABSL_GUARDED_BY(mu_);
+  // The highest match number handed out so far.
+  uint32_t last_number_ ABSL_GUARDED_BY(mu_) = 0;
+  bool paired_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Mirrors outstanding_matches_.size() for lock-free reads, plus one count
+  // held until pairings have been generated, so that a round which is still
+  // being paired never reads as complete.
+  std::atomic<uint32_t> outstanding_count_{1};
+  absl::Notification complete_;
+  std::vector<std::function<void(Round)>> on_complete_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace internal
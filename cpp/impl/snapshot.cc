@@ -0,0 +1,255 @@
+#include "cpp/impl/snapshot.h"
+
+#include <limits>
+#include <type_traits>
+
+#include "absl/status/status.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+constexpr absl::string_view kMagic = "TCGS";
+constexpr uint64_t kVersion = 1;
+
+class Writer {
+ public:
+  void Varint(uint64_t v) {
+    while (v >= 0x80) {
+      out_.push_back(static_cast<char>(v | 0x80));
+      v >>= 7;
+    }
+    out_.push_back(static_cast<char>(v));
+  }
+  void Bool(bool v) { Varint(v ? 1 : 0); }
+  void String(absl::string_view s) {
+    Varint(s.size());
+    out_.append(s.data(), s.size());
+  }
+  void Frac(const Fraction& f) {
+    Varint(f.numer());
+    Varint(f.denom());
+  }
+  // The match id is implied by the match the result is for.
+  void Result(const std::optional<MatchResult>& r) {
+    Bool(r.has_value());
+    if (!r.has_value()) return;
+    Bool(r->winner.has_value());
+    if (r->winner.has_value()) Varint(*r->winner);
+    Varint(r->winner_games_won);
+    Varint(r->winner_games_lost);
+    Varint(r->games_drawn);
+  }
+
+  std::string Take() { return std::move(out_); }
+
+ private:
+  std::string out_;
+};
+
+// Every read fails once one has, so callers check ok() once at the end.
+class Reader {
+ public:
+  explicit Reader(absl::string_view in) : in_(in) {}
+
+  bool ok() const { return ok_; }
+  bool done() const { return in_.empty(); }
+
+  uint64_t Varint() {
+    uint64_t v = 0;
+    for (int shift = 0; ok_ && shift < 64; shift += 7) {
+      if (in_.empty()) break;
+      const uint8_t byte = static_cast<uint8_t>(in_.front());
+      in_.remove_prefix(1);
+      v |= uint64_t{byte & 0x7fu} << shift;
+      if ((byte & 0x80) == 0) return v;
+    }
+    ok_ = false;
+    return 0;
+  }
+  template <typename T>
+  T Int() {
+    const uint64_t v = Varint();
+    if (v > std::numeric_limits<T>::max()) ok_ = false;
+    return ok_ ? static_cast<T>(v) : T{};
+  }
+  // An enum stored as its underlying value, which must be at most `last`.
+  template <typename E>
+  E Enum(E last) {
+    using T = std::underlying_type_t<E>;
+    const T v = Int<T>();
+    if (v > static_cast<T>(last)) ok_ = false;
+    return ok_ ? static_cast<E>(v) : E{};
+  }
+  bool Bool() { return Int<uint8_t>() != 0; }
+  std::string String() {
+    const uint64_t size = Varint();
+    if (!ok_ || size > in_.size()) {
+      ok_ = false;
+      return "";
+    }
+    std::string out(in_.substr(0, size));
+    in_.remove_prefix(size);
+    return out;
+  }
+  Fraction Frac() {
+    const uint64_t numer = Varint();
+    const uint64_t denom = Varint();
+    if (denom == 0) ok_ = false;
+    return ok_ ? Fraction(numer, denom) : Fraction();
+  }
+  std::optional<MatchResult> Result(MatchId id) {
+    if (!Bool()) return std::nullopt;
+    MatchResult r;
+    r.id = id;
+    if (Bool()) r.winner = Varint();
+    r.winner_games_won = Int<uint16_t>();
+    r.winner_games_lost = Int<uint16_t>();
+    r.games_drawn = Int<uint16_t>();
+    return r;
+  }
+  // Guards reserve() against sizes a corrupt snapshot could claim.
+  size_t Count() {
+    const uint64_t n = Varint();
+    if (n > in_.size()) ok_ = false;
+    return ok_ ? static_cast<size_t>(n) : 0;
+  }
+
+ private:
+  absl::string_view in_;
+  bool ok_ = true;
+};
+}  // namespace
+
+std::string EncodeSnapshot(const TournamentSnapshot& snapshot) {
+  Writer w;
+  w.String(kMagic);
+  w.Varint(kVersion);
+  w.Varint(snapshot.seed);
+  w.Varint(snapshot.next_seq);
+
+  w.Varint(snapshot.players.size());
+  for (const auto& p : snapshot.players) {
+    w.Varint(p.info.id);
+    w.String(p.info.first_name);
+    w.String(p.info.last_name);
+    w.String(p.info.username);
+    w.Bool(p.dropped);
+    w.Bool(p.pinned_table.has_value());
+    if (p.pinned_table.has_value()) w.Varint(*p.pinned_table);
+    w.Varint(p.avoidance.size());
+    for (const auto& rule : p.avoidance) {
+      w.Varint(rule.group);
+      w.Varint(static_cast<uint8_t>(rule.strength));
+      w.Varint(rule.through_round);
+    }
+  }
+
+  w.Varint(snapshot.rounds.size());
+  for (const auto& r : snapshot.rounds) {
+    w.Varint(r.id);
+    w.Varint(r.matches.size());
+    for (const auto& m : r.matches) {
+      w.Varint(m.id.number);
+      w.Varint(m.a);
+      w.Varint(m.b);
+      w.Bool(m.assigned_loss);
+      w.Result(m.a_result);
+      w.Result(m.b_result);
+      w.Result(m.committed);
+      w.Bool(m.table.has_value());
+      if (m.table.has_value()) {
+        w.Varint(m.table->number);
+        w.Varint(m.table->section);
+      }
+    }
+  }
+
+  w.Varint(snapshot.bracket_seeds.size());
+  for (Player::Id id : snapshot.bracket_seeds) w.Varint(id);
+
+  w.Varint(snapshot.standings.size());
+  for (const auto& s : snapshot.standings) {
+    w.Varint(s.round);
+    w.Varint(s.entries.size());
+    for (const auto& [id, info] : s.entries) {
+      w.Varint(id);
+      w.Varint(info.match_points);
+      w.Frac(info.opp_mwp);
+      w.Frac(info.gwp);
+      w.Frac(info.opp_gwp);
+    }
+  }
+  return w.Take();
+}
+
+absl::StatusOr<TournamentSnapshot> DecodeSnapshot(absl::string_view data) {
+  Reader r(data);
+  if (r.String() != kMagic || r.Varint() != kVersion || !r.ok()) {
+    return absl::DataLossError("Not a tournament snapshot of this version.");
+  }
+
+  TournamentSnapshot out;
+  out.seed = r.Varint();
+  out.next_seq = r.Varint();
+
+  out.players.resize(r.Count());
+  for (auto& p : out.players) {
+    p.info.id = r.Varint();
+    p.info.first_name = r.String();
+    p.info.last_name = r.String();
+    p.info.username = r.String();
+    p.dropped = r.Bool();
+    if (r.Bool()) p.pinned_table = r.Int<uint32_t>();
+    p.avoidance.resize(r.Count());
+    for (auto& rule : p.avoidance) {
+      rule.group = r.Varint();
+      rule.strength = r.Enum(Avoidance::kSoft);
+      rule.through_round = r.Int<uint8_t>();
+    }
+  }
+
+  out.rounds.resize(r.Count());
+  for (auto& round : out.rounds) {
+    round.id = r.Int<RoundId>();
+    round.matches.resize(r.Count());
+    for (auto& m : round.matches) {
+      m.id = MatchId{round.id, r.Int<uint32_t>()};
+      m.a = r.Varint();
+      m.b = r.Varint();
+      m.assigned_loss = r.Bool();
+      m.a_result = r.Result(m.id);
+      m.b_result = r.Result(m.id);
+      m.committed = r.Result(m.id);
+      if (r.Bool()) {
+        TableMap::Table table;
+        table.number = r.Int<uint32_t>();
+        table.section = r.Int<uint32_t>();
+        m.table = table;
+      }
+    }
+  }
+
+  out.bracket_seeds.resize(r.Count());
+  for (Player::Id& id : out.bracket_seeds) id = r.Varint();
+
+  out.standings.resize(r.Count());
+  for (auto& s : out.standings) {
+    s.round = r.Int<RoundId>();
+    s.entries.resize(r.Count());
+    for (auto& [id, info] : s.entries) {
+      id = r.Varint();
+      info.match_points = r.Int<uint16_t>();
+      info.opp_mwp = r.Frac();
+      info.gwp = r.Frac();
+      info.opp_gwp = r.Frac();
+    }
+  }
+
+  if (!r.ok() || !r.done()) {
+    return absl::DataLossError("Tournament snapshot is truncated or corrupt.");
+  }
+  return out;
+}
+
+}  // namespace internal
+}  // namespace tcgtc
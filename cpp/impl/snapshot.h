@@ -0,0 +1,89 @@
+// This file defines a compact, self-contained snapshot of a tournament, e.g.
+// for writing an idle tournament out to disk and reloading it later.
+//
+// A snapshot records what happened rather than what was derived from it:
+// players, each round's matches with every report and committed result, where
+// each match was seated, and the published standings. Player records, the
+// pairing index and the bracket are rebuilt by replaying the results in order.
+// Pairing diagnostics and speculative pairings are not kept.
+//
+// The encoding is a versioned stream of varints, with no field names, so a
+// snapshot is a few bytes per match.
+
+#ifndef _TCGTC_SNAPSHOT_H_
+#define _TCGTC_SNAPSHOT_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "cpp/definitions.h"
+#include "cpp/match-id.h"
+#include "cpp/match-result.h"
+#include "cpp/impl/player.h"
+#include "cpp/impl/tables.h"
+#include "cpp/pairings/avoidance.h"
+#include "cpp/tiebreaker.h"
+
+namespace tcgtc {
+namespace internal {
+
+struct TournamentSnapshot {
+  // Seeds the restored tournament's random number generator.
+  uint64_t seed = 0;
+  // The sequence number the restored tournament's change feed continues from.
+  uint64_t next_seq = 1;
+
+  struct PlayerEntry {
+    Player::Impl::Options info;
+    bool dropped = false;
+    std::optional<uint32_t> pinned_table;
+    std::vector<AvoidanceRule> avoidance;
+  };
+  // In id order.
+  std::vector<PlayerEntry> players;
+
+  struct MatchEntry {
+    MatchId id = {0, 0};
+    Player::Id a = kNoPlayer;
+    // kNoPlayer for a bye or an assigned loss.
+    Player::Id b = kNoPlayer;
+    bool assigned_loss = false;
+    std::optional<MatchResult> a_result;
+    std::optional<MatchResult> b_result;
+    std::optional<MatchResult> committed;
+    std::optional<TableMap::Table> table;
+  };
+  struct RoundEntry {
+    RoundId id = 0;
+    // In match number order.
+    std::vector<MatchEntry> matches;
+  };
+  // In round order.
+  std::vector<RoundEntry> rounds;
+
+  // Empty until the bracket is seeded.
+  std::vector<Player::Id> bracket_seeds;
+
+  struct StandingsEntry {
+    RoundId round = 0;
+    std::vector<std::pair<Player::Id, TieBreakInfo>> entries;
+  };
+  // Every version published, in round order.
+  std::vector<StandingsEntry> standings;
+};
+
+std::string EncodeSnapshot(const TournamentSnapshot& snapshot);
+
+// Returns a DataLoss error if `data` is truncated, corrupt or of another
+// version.
+absl::StatusOr<TournamentSnapshot> DecodeSnapshot(absl::string_view data);
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_SNAPSHOT_H_
@@ -0,0 +1,183 @@
+#include "cpp/impl/speculative.h"
+
+#include <random>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "cpp/player-match.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+// Win for the first player, win for the second player, or a draw.
+constexpr size_t kOutcomesPerMatch = 3;
+
+uint64_t PlayerHash(Player::Id id, uint32_t points) {
+  return absl::Hash<std::pair<Player::Id, uint32_t>>{}({id, points});
+}
+}  // namespace
+
+uint64_t ScoreGroupFingerprint(const ScoreGroups& groups) {
+  // Summation keeps this independent of the order of players in a group.
+  uint64_t out = 0;
+  for (const auto& [points, players] : groups) {
+    for (const auto& p : players) out += PlayerHash(p->id(), points);
+  }
+  return out;
+}
+
+bool SpeculativePairer::Speculate(RoundId round, const ScoreGroups& groups,
+                                  const std::vector<Match>& outstanding,
+                                  uint64_t seed, Executor& executor,
+                                  PairFn pair) {
+  if (outstanding.empty() || outstanding.size() > opts_.max_outstanding) {
+    return false;
+  }
+  size_t num_outcomes = 1;
+  for (size_t i = 0; i < outstanding.size(); ++i) {
+    num_outcomes *= kOutcomesPerMatch;
+    if (num_outcomes > opts_.max_outcomes) return false;
+  }
+  {
+    // Checked again when installing the candidates; this only saves building
+    // them in the common case.
+    absl::MutexLock l(&mu_);
+    if (round_ == round) return false;
+  }
+
+  // Current points of every active player in an outstanding match. Players
+  // who are no longer active are not in the score groups at all.
+  absl::flat_hash_set<Player::Id> in_play;
+  for (const auto& m : outstanding) {
+    in_play.insert(m->player_a()->id());
+    if (!m->is_bye()) in_play.insert((*m->player_b())->id());
+  }
+  absl::flat_hash_map<Player::Id, uint32_t> current;
+  for (const auto& [points, players] : groups) {
+    for (const auto& p : players) {
+      if (in_play.contains(p->id())) current[p->id()] = points;
+    }
+  }
+
+  const uint64_t base_fingerprint = ScoreGroupFingerprint(groups);
+  auto base = std::make_shared<const ScoreGroups>(groups);
+  auto shared_pair = std::make_shared<const PairFn>(std::move(pair));
+
+  std::vector<std::shared_ptr<Candidate>> candidates;
+  candidates.reserve(num_outcomes);
+  for (size_t outcome = 0; outcome < num_outcomes; ++outcome) {
+    // Decode the outcome of each match as a base-3 digit.
+    absl::flat_hash_map<Player::Id, uint32_t> points;
+    size_t code = outcome;
+    for (const auto& m : outstanding) {
+      const size_t digit = code % kOutcomesPerMatch;
+      code /= kOutcomesPerMatch;
+      if (m->is_bye()) continue;
+      auto award = [&](Player::Id id, uint32_t match_points) {
+        if (auto it = current.find(id); it != current.end()) {
+          points[id] = it->second + match_points;
+        }
+      };
+      award(m->player_a()->id(), digit == 0 ? 3 : digit == 2 ? 1 : 0);
+      award((*m->player_b())->id(), digit == 1 ? 3 : digit == 2 ? 1 : 0);
+    }
+
+    auto candidate = std::make_shared<Candidate>();
+    candidate->fingerprint = base_fingerprint;
+    for (const auto& [id, pts] : points) {
+      candidate->fingerprint += PlayerHash(id, pts) - PlayerHash(id, current[id]);
+    }
+    candidate->pair = [base, shared_pair, points = std::move(points),
+                       seed = seed + outcome]() {
+      ScoreGroups hypothetical;
+      for (const auto& [pts, players] : *base) {
+        for (const auto& p : players) {
+          auto it = points.find(p->id());
+          hypothetical[it == points.end() ? pts : it->second].push_back(p);
+        }
+      }
+      std::mt19937_64 rand(seed);
+      return (*shared_pair)(hypothetical, rand);
+    };
+    candidates.push_back(std::move(candidate));
+  }
+
+  {
+    // Checked and installed together, so that of two concurrent callers for
+    // the same round only one installs (and schedules) its candidates.
+    absl::MutexLock l(&mu_);
+    if (round_ == round) return false;
+    ClearLocked();
+    round_ = round;
+    candidates_ = candidates;
+  }
+  for (auto& candidate : candidates) {
+    executor.Schedule([candidate = std::move(candidate)]() {
+      if (candidate->claimed.exchange(true, std::memory_order_acq_rel)) return;
+      candidate->pairing = candidate->pair();
+      candidate->pair = nullptr;
+      candidate->done.Notify();
+    });
+  }
+  return true;
+}
+
+std::optional<PartialPairing> SpeculativePairer::Take(
+    const ScoreGroups& groups) {
+  const uint64_t fingerprint = ScoreGroupFingerprint(groups);
+  std::shared_ptr<Candidate> match;
+  {
+    absl::MutexLock l(&mu_);
+    for (auto& c : candidates_) {
+      if (c->fingerprint == fingerprint) {
+        match = c;
+      } else {
+        c->claimed.store(true, std::memory_order_release);
+      }
+    }
+    candidates_.clear();
+    round_.reset();
+  }
+  if (match == nullptr) return std::nullopt;
+
+  // Never wait on a task which has not started: it may be queued on the
+  // executor the caller is running on, behind the caller itself.
+  if (!match->claimed.exchange(true, std::memory_order_acq_rel)) {
+    PartialPairing out = match->pair();
+    match->pair = nullptr;
+    return out;
+  }
+  match->done.WaitForNotification();
+  return std::move(match->pairing);
+}
+
+size_t SpeculativePairer::BytesUsed() const {
+  absl::MutexLock l(&mu_);
+  size_t bytes = HeapBytes(candidates_);
+  for (const auto& c : candidates_) {
+    bytes += sizeof(Candidate) + kSharedControlBytes;
+    // Take() only moves a pairing out once the candidate has left candidates_.
+    if (c->done.HasBeenNotified()) {
+      bytes += HeapBytes(c->pairing.paired) + HeapBytes(c->pairing.unpaired);
+    }
+  }
+  return bytes;
+}
+
+void SpeculativePairer::Clear() {
+  absl::MutexLock l(&mu_);
+  ClearLocked();
+}
+
+void SpeculativePairer::ClearLocked() {
+  for (auto& c : candidates_) {
+    c->claimed.store(true, std::memory_order_release);
+  }
+  candidates_.clear();
+  round_.reset();
+}
+
+}  // namespace internal
+}  // namespace tcgtc
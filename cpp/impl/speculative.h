@@ -0,0 +1,99 @@
+// Speculative precomputation of the next round's pairings. When only a few
+// matches of a round are outstanding, we pair the next round in the background
+// once for every plausible outcome of those matches (win/loss/draw each), so
+// that when the last result lands the pairings can be published immediately.
+//
+// Candidates are keyed by a fingerprint of the score groups they were paired
+// from. Any divergence from the speculated state (a judge fix, a drop, etc.)
+// simply means no candidate matches, and we fall back to pairing as usual.
+
+#ifndef _TCGTC_SPECULATIVE_H_
+#define _TCGTC_SPECULATIVE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "cpp/definitions.h"
+#include "cpp/executor.h"
+#include "cpp/memory-usage.h"
+#include "cpp/pairings/isomorphism.h"
+
+namespace tcgtc {
+namespace internal {
+
+// An order independent fingerprint of (player, match points) for all players.
+uint64_t ScoreGroupFingerprint(const ScoreGroups& groups);
+
+class SpeculativePairer {
+ public:
+  struct Options {
+    // Only speculate once at most this many matches are outstanding.
+    size_t max_outstanding = 3;
+    // Cap on the number of outcomes (3^outstanding) we pair speculatively.
+    size_t max_outcomes = 27;
+  };
+  // Pairs a set of (hypothetical) score groups. Runs on the executor, so must
+  // not depend on the caller outliving it.
+  using PairFn =
+      std::function<PartialPairing(const ScoreGroups&, std::mt19937_64&)>;
+
+  explicit SpeculativePairer(const Options& opts) : opts_(opts) {}
+  ~SpeculativePairer() { Clear(); }
+
+  const Options& options() const { return opts_; }
+
+  // Schedules one pairing per plausible outcome of `outstanding`, starting from
+  // the current `groups`, by `pair`. Returns false (and does nothing) if we are
+  // already speculating for `round`, or there are too many outcomes.
+  bool Speculate(RoundId round, const ScoreGroups& groups,
+                 const std::vector<Match>& outstanding, uint64_t seed,
+                 Executor& executor, PairFn pair) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the precomputed pairing for `groups` if we speculated on it, and
+  // discards all other candidates. A candidate which has not started is paired
+  // here instead (its task may be queued behind the caller on the same
+  // executor); one which has started is waited for.
+  std::optional<PartialPairing> Take(const ScoreGroups& groups)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Discards all candidates, cancelling any that have not started.
+  void Clear() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The candidates held, including the pairings finished so far, in bytes (see
+  // cpp/memory-usage.h).
+  size_t BytesUsed() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Candidate {
+    uint64_t fingerprint = 0;
+    // Set by whoever runs `pair` (the executor task or Take()), or by a
+    // cancellation, so that it runs at most once.
+    std::atomic<bool> claimed{false};
+    // Pairs the hypothetical score groups. Only run by the claimant.
+    std::function<PartialPairing()> pair;
+    // Notified once the executor task has written `pairing`.
+    absl::Notification done;
+    PartialPairing pairing;
+  };
+
+  void ClearLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options opts_;
+
+  mutable absl::Mutex mu_;
+  std::optional<RoundId> round_ ABSL_GUARDED_BY(mu_);
+  std::vector<std::shared_ptr<Candidate>> candidates_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_SPECULATIVE_H_
@@ -0,0 +1,221 @@
+#include "cpp/impl/standings.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
+#include "cpp/fraction.h"
+#include "cpp/trace.h"
+#include "cpp/util.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+// Bounded below by the policy's floor. A player with no games or matches played
+// is treated as being at that floor.
+template <typename Policy>
+Fraction BoundedPercentage(uint64_t points, uint64_t played) {
+  if (played == 0) return Policy::Floor();
+  return Policy::Bound(Fraction(points, 3 * played));
+}
+
+// True if `l` places ahead of `r`.
+bool Ahead(const Standing& l, const Standing& r) {
+  if (r.key < l.key) return true;
+  if (l.key < r.key) return false;
+  return l.p->id() < r.p->id();
+}
+
+template <typename Policy>
+std::vector<Standing> ComputeEntries(const StandingsSnapshot& snapshot) {
+  const auto& records = snapshot.records;
+
+  // Each player's own (bounded) match and game win percentages, which feed
+  // into their opponents' breakers.
+  std::vector<Fraction> mwp;
+  std::vector<Fraction> gwp;
+  mwp.reserve(records.size());
+  gwp.reserve(records.size());
+  for (const auto& r : records) {
+    mwp.push_back(BoundedPercentage<Policy>(r.match_points, r.matches_played));
+    gwp.push_back(BoundedPercentage<Policy>(r.game_points, r.games_played));
+  }
+
+  std::vector<Standing> standing;
+  standing.reserve(records.size());
+  for (uint32_t i = 0; i < records.size(); ++i) {
+    const auto& r = records[i];
+    uint64_t opponents = r.opponents.size();
+    Fraction omwp_sum(0);
+    Fraction ogwp_sum(0);
+    for (uint32_t opp : r.opponents) {
+      omwp_sum += mwp[opp];
+      ogwp_sum += gwp[opp];
+    }
+    if constexpr (Policy::kByes == ByeHandling::kFloorOpponent) {
+      for (uint16_t b = 0; b < r.byes; ++b) {
+        omwp_sum += Policy::Floor();
+        ogwp_sum += Policy::Floor();
+      }
+      opponents += r.byes;
+    }
+
+    TieBreakInfo info;
+    info.match_points = r.match_points;
+    if (opponents == 0) {
+      // TODO: Make sure this aligns with MTR. Probably just an R1/2 corner case.
+      static const Fraction kOne(1);
+      info.opp_mwp = kOne;
+      info.gwp = kOne;
+      info.opp_gwp = kOne;
+    } else {
+      Fraction divisor(opponents);
+      info.opp_mwp = omwp_sum / divisor;
+      info.gwp = gwp[i];
+      info.opp_gwp = ogwp_sum / divisor;
+    }
+    standing.push_back(
+        Standing{0, snapshot.players[i], info, Policy::Key(info)});
+  }
+  return standing;
+}
+}  // namespace
+
+// Standings -------------------------------------------------------------------
+struct Standings::Data {
+  // In no particular order; `place` is unset.
+  std::vector<Standing> entries;
+
+  // The rank index. Built at most once, after which `indexed` is set.
+  absl::once_flag once;
+  std::atomic<bool> indexed{false};
+  // Indices into entries, by place.
+  std::vector<uint32_t> order;
+  // Player id to (0-indexed) place.
+  absl::flat_hash_map<Player::Id, uint32_t> place;
+};
+
+Standings::Standings(RoundId round, std::vector<Standing> entries)
+  : round_(round), data_(std::make_shared<Data>()) {
+  data_->entries = std::move(entries);
+}
+
+size_t Standings::size() const {
+  return data_ == nullptr ? 0 : data_->entries.size();
+}
+
+size_t Standings::BytesUsed() const {
+  if (data_ == nullptr) return 0;
+  size_t bytes =
+      sizeof(Data) + kSharedControlBytes + HeapBytes(data_->entries);
+  if (data_->indexed.load(std::memory_order_acquire)) {
+    bytes += HeapBytes(data_->order) + HeapBytes(data_->place);
+  }
+  return bytes;
+}
+
+const Standings::Data& Standings::Indexed() const {
+  Data& d = *data_;
+  absl::call_once(d.once, [&d]() {
+    d.order.resize(d.entries.size());
+    for (uint32_t i = 0; i < d.order.size(); ++i) d.order[i] = i;
+    std::sort(d.order.begin(), d.order.end(), [&d](uint32_t l, uint32_t r) {
+      return Ahead(d.entries[l], d.entries[r]);
+    });
+    d.place.reserve(d.order.size());
+    for (uint32_t place = 0; place < d.order.size(); ++place) {
+      d.place.insert({d.entries[d.order[place]].p->id(), place});
+    }
+    d.indexed.store(true, std::memory_order_release);
+  });
+  return d;
+}
+
+std::vector<Standing> Standings::TopK(size_t k) const {
+  k = std::min(k, size());
+  if (k == 0) return {};
+
+  // A full ordering would be wasted on a single cut check, so select with a
+  // heap unless someone has already paid for the rank index.
+  if (k == size() || data_->indexed.load(std::memory_order_acquire)) {
+    return Page(0, k);
+  }
+  std::vector<Standing> out;
+  out.reserve(k);
+  const auto& entries = data_->entries;
+  std::vector<uint32_t> heap(entries.size());
+  for (uint32_t i = 0; i < heap.size(); ++i) heap[i] = i;
+  auto behind = [&entries](uint32_t l, uint32_t r) {
+    return Ahead(entries[r], entries[l]);
+  };
+  std::make_heap(heap.begin(), heap.end(), behind);
+  for (size_t place = 1; place <= k; ++place) {
+    std::pop_heap(heap.begin(), heap.end(), behind);
+    out.push_back(entries[heap.back()]);
+    out.back().place = place;
+    heap.pop_back();
+  }
+  return out;
+}
+
+std::vector<Standing> Standings::Page(size_t offset, size_t count) const {
+  std::vector<Standing> out;
+  if (offset >= size()) return out;
+  // Clamped before adding, so that e.g. SIZE_MAX ("the rest") cannot wrap.
+  count = std::min(count, size() - offset);
+  const Data& d = Indexed();
+  const size_t end = offset + count;
+  out.reserve(count);
+  for (size_t i = offset; i < end; ++i) {
+    out.push_back(d.entries[d.order[i]]);
+    out.back().place = i + 1;  // Switch to 1-index.
+  }
+  return out;
+}
+
+absl::StatusOr<Standing> Standings::Find(Player::Id player) const {
+  if (data_ != nullptr) {
+    const Data& d = Indexed();
+    if (auto it = d.place.find(player); it != d.place.end()) {
+      Standing out = d.entries[d.order[it->second]];
+      out.place = it->second + 1;  // Switch to 1-index.
+      return out;
+    }
+  }
+  return Err("No standing for player ID (", player, ") in Round ",
+             (round_ & kRoundMask), " standings.");
+}
+
+StandingsSnapshot CaptureStandingsSnapshot(RoundId round,
+                                           std::vector<Player> players) {
+  TraceSpan span("standings snapshot");
+  span.AddArg("players", players.size());
+  StandingsSnapshot out;
+  out.round = round;
+  out.players = std::move(players);
+
+  absl::flat_hash_map<Player::Id, uint32_t> index;
+  index.reserve(out.players.size());
+  for (uint32_t i = 0; i < out.players.size(); ++i) {
+    index.insert({out.players[i]->id(), i});
+  }
+
+  out.records.reserve(out.players.size());
+  for (const auto& p : out.players) out.records.push_back(p->GetRecord(index));
+  return out;
+}
+
+Standings ComputeStandings(const StandingsSnapshot& snapshot,
+                           TieBreakRules rules) {
+  TraceSpan span("compute standings");
+  span.AddArg("players", snapshot.players.size());
+  auto entries = WithTieBreakPolicy(rules, [&snapshot](auto policy) {
+    return ComputeEntries<decltype(policy)>(snapshot);
+  });
+  // Ordering is deferred to the queries; see Standings.
+  return Standings(snapshot.round, std::move(entries));
+}
+
+}  // namespace internal
+}  // namespace tcgtc
@@ -0,0 +1,94 @@
+// This file defines the standings pipeline. Standings are computed from an
+// immutable snapshot of every player's record, so the (comparatively slow)
+// tie-breaker computation and sort never hold a Tournament, Round, Match or
+// Player lock, and can happen on a background thread.
+
+#ifndef _TCGTC_STANDINGS_H_
+#define _TCGTC_STANDINGS_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "cpp/definitions.h"
+#include "cpp/match-id.h"
+#include "cpp/memory-usage.h"
+#include "cpp/player-match.h"
+#include "cpp/tiebreaker.h"
+
+namespace tcgtc {
+namespace internal {
+
+struct Standing {
+  int place;
+  Player p;
+  TieBreakInfo info;
+  // `info` in the order the tournament's rule set compares it.
+  TieBreakKey key;
+};
+
+// An immutable, published version of the standings. Copies share the same
+// version.
+//
+// Standings are not sorted up front, since most queries only want the top of
+// the field (e.g. the cut for the bracket). TopK() does a partial selection,
+// while queries needing a full ordering (Find, Page) build a rank index once
+// per version and reuse it from then on.
+//
+// Players with identical breakers are ordered by player id, so that the order
+// is total and every query agrees on it.
+class Standings {
+ public:
+  Standings() = default;
+  Standings(RoundId round, std::vector<Standing> entries);
+
+  // The last round whose results are included.
+  RoundId round() const { return round_; }
+  size_t size() const;
+
+  // The best `k` players, in order. O(n + k log n) until the rank index is
+  // built, and O(k) after.
+  std::vector<Standing> TopK(size_t k) const;
+
+  // Players placed [offset + 1, offset + count], in order.
+  std::vector<Standing> Page(size_t offset, size_t count) const;
+
+  // The given player's standing, including their place.
+  absl::StatusOr<Standing> Find(Player::Id player) const;
+
+  std::vector<Standing> All() const { return Page(0, size()); }
+
+  // The version's entries and rank index (if built), in bytes (see
+  // cpp/memory-usage.h). Copies share these.
+  size_t BytesUsed() const;
+
+ private:
+  struct Data;
+  // Builds the rank index, if it has not been already.
+  const Data& Indexed() const;
+
+  RoundId round_ = 0;
+  std::shared_ptr<Data> data_;
+};
+
+struct StandingsSnapshot {
+  RoundId round = 0;
+  std::vector<Player> players;
+  // Parallel to `players`.
+  std::vector<PlayerRecord> records;
+};
+
+// Takes each player's lock in turn (never more than one at a time).
+StandingsSnapshot CaptureStandingsSnapshot(RoundId round,
+                                           std::vector<Player> players);
+
+// Takes no locks. The rule set is resolved once, up front; the breaker
+// computation and comparisons are then specialized for it.
+Standings ComputeStandings(const StandingsSnapshot& snapshot,
+                           TieBreakRules rules = TieBreakRules::kMtr);
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_STANDINGS_H_
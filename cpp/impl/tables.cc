@@ -0,0 +1,120 @@
+#include "cpp/impl/tables.h"
+
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+#include "absl/container/flat_hash_set.h"
+#include "cpp/player-match.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+struct Seating {
+  Match m;
+  uint32_t points = 0;
+  // The higher of the two players' match points, to break ties.
+  uint32_t top = 0;
+};
+
+// The section holding `table`, or the last one if none does.
+uint32_t SectionOf(const std::vector<TableSection>& sections, uint32_t table) {
+  for (uint32_t s = 0; s < sections.size(); ++s) {
+    const auto& section = sections[s];
+    if (table < section.first_table) continue;
+    if (section.num_tables == 0 ||
+        table - section.first_table < section.num_tables) {
+      return s;
+    }
+  }
+  return sections.size() - 1;
+}
+}  // namespace
+
+std::optional<TableMap::Table> TableMap::ForMatch(const MatchId& id) const {
+  if (auto it = by_match_.find(id); it != by_match_.end()) return it->second;
+  return std::nullopt;
+}
+
+TableMap TableMap::Restore(std::vector<TableSection> sections,
+                           absl::flat_hash_map<MatchId, Table> by_match) {
+  TableMap out;
+  out.sections_ = std::move(sections);
+  out.by_match_ = std::move(by_match);
+  return out;
+}
+
+size_t TableMap::BytesUsed() const {
+  size_t bytes = HeapBytes(sections_) + HeapBytes(by_match_);
+  for (const TableSection& section : sections_) bytes += HeapBytes(section.name);
+  return bytes;
+}
+
+TableMap AssignTables(const std::vector<Match>& matches,
+                      const std::vector<TableSection>& sections,
+                      const absl::flat_hash_map<Player::Id, uint32_t>& pinned) {
+  assert(!sections.empty());
+  TableMap out;
+  out.sections_ = sections;
+
+  std::vector<Seating> order;
+  order.reserve(matches.size());
+  for (const auto& m : matches) {
+    if (m->is_bye()) continue;
+    const uint32_t a = m->player_a()->match_points();
+    const uint32_t b = (*m->player_b())->match_points();
+    order.push_back({m, a + b, std::max(a, b)});
+  }
+  // Best first, then by match number so that seating is deterministic.
+  std::sort(order.begin(), order.end(), [](const auto& l, const auto& r) {
+    return std::make_tuple(r.points, r.top, l.m->id()) <
+           std::make_tuple(l.points, l.top, r.m->id());
+  });
+
+  out.by_match_.reserve(order.size());
+  absl::flat_hash_set<uint32_t> taken;
+  taken.reserve(order.size());
+  auto seat = [&](const Match& m, TableMap::Table table) {
+    taken.insert(table.number);
+    out.by_match_.insert({m->id(), table});
+  };
+
+  // Pinned players first, so that their tables are not handed out. If both
+  // players are pinned, or two pins clash, the first free table wins.
+  std::vector<bool> seated(order.size(), false);
+  if (!pinned.empty()) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      const Match& m = order[i].m;
+      for (const Player& p : {m->player_a(), *m->player_b()}) {
+        auto it = pinned.find(p->id());
+        if (it == pinned.end() || taken.contains(it->second)) continue;
+        seat(m, {it->second, SectionOf(sections, it->second)});
+        seated[i] = true;
+        break;
+      }
+    }
+  }
+
+  uint32_t section = 0;
+  uint32_t next = sections.front().first_table;
+  auto next_free = [&]() {
+    for (;;) {
+      const auto& s = sections[section];
+      const bool full =
+          s.num_tables != 0 && next - s.first_table >= s.num_tables;
+      if (full && section + 1 < sections.size()) {
+        next = sections[++section].first_table;
+        continue;
+      }
+      const uint32_t table = next++;
+      if (!taken.contains(table)) return TableMap::Table{table, section};
+    }
+  };
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (!seated[i]) seat(order[i].m, next_free());
+  }
+  return out;
+}
+
+}  // namespace internal
+}  // namespace tcgtc
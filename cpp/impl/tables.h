@@ -0,0 +1,78 @@
+// This file defines table assignment, which seats a round's matches once it is
+// paired:
+//   - Matches are seated by the combined match points of their players, so the
+//     top tables hold the top matches.
+//   - A player pinned to a table (e.g. for accessibility, or a feature match)
+//     keeps it.
+//   - Tables may be split into sections (e.g. the halls of a split venue),
+//     which are filled in order.
+// Byes take no table.
+//
+// Assignment is O(n log n). The result is immutable, and players find their
+// table through the round's PairingBoard.
+
+#ifndef _TCGTC_TABLES_H_
+#define _TCGTC_TABLES_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "cpp/definitions.h"
+#include "cpp/match-id.h"
+#include "cpp/memory-usage.h"
+
+namespace tcgtc {
+namespace internal {
+
+struct TableSection {
+  std::string name;
+  uint32_t first_table = 1;
+  // 0 for no limit, which only makes sense for the last section.
+  uint32_t num_tables = 0;
+};
+
+class TableMap {
+ public:
+  struct Table {
+    uint32_t number = 0;
+    // Index into the sections the map was assigned with.
+    uint32_t section = 0;
+  };
+
+  // O(1). Unset for Byes, and for matches not in the round.
+  std::optional<Table> ForMatch(const MatchId& id) const;
+
+  // A seating assigned earlier, e.g. for a round being restored.
+  static TableMap Restore(std::vector<TableSection> sections,
+                          absl::flat_hash_map<MatchId, Table> by_match);
+
+  const std::vector<TableSection>& sections() const { return sections_; }
+  size_t size() const { return by_match_.size(); }
+
+  // The heap storage held, in bytes (see cpp/memory-usage.h).
+  size_t BytesUsed() const;
+
+ private:
+  friend TableMap AssignTables(
+      const std::vector<Match>& matches,
+      const std::vector<TableSection>& sections,
+      const absl::flat_hash_map<Player::Id, uint32_t>& pinned);
+
+  std::vector<TableSection> sections_;
+  absl::flat_hash_map<MatchId, Table> by_match_;
+};
+
+// Seats `matches` across `sections` (which must not be empty), honouring
+// `pinned` (player to table) where the table is free. If the sections run out,
+// numbering carries on past the end of the last one.
+TableMap AssignTables(const std::vector<Match>& matches,
+                      const std::vector<TableSection>& sections,
+                      const absl::flat_hash_map<Player::Id, uint32_t>& pinned);
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_TABLES_H_
@@ -0,0 +1,354 @@
+#include "cpp/impl/tournament-manager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "cpp/metrics.h"
+#include "cpp/impl/snapshot.h"
+#include "cpp/util.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+// SplitMix64's finalizer, so that nearby ids get unrelated seeds.
+uint64_t Mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+uint64_t HardwareSeed() {
+  std::random_device device;
+  return (uint64_t{device()} << 32) | device();
+}
+
+// Written to a temporary file first, so that a crash never leaves a partial
+// snapshot behind.
+absl::Status WriteFile(const std::string& path, absl::string_view data) {
+  const std::string tmp = absl::StrCat(path, ".tmp");
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out) return absl::InternalError(absl::StrCat("Could not write ", tmp));
+  }
+  // Renaming over an existing file fails on Windows.
+  std::remove(path.c_str());
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    return absl::InternalError(absl::StrCat("Could not rename ", tmp));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return absl::NotFoundError(absl::StrCat("Could not open ", path));
+  // Truncation is caught when decoding.
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+}  // namespace
+
+TournamentManager::TournamentManager(const Options& opts)
+  : seed_(opts.seed.has_value() ? *opts.seed : HardwareSeed()),
+    snapshot_dir_(opts.snapshot_dir), idle_timeout_(opts.idle_timeout) {
+  const size_t n = opts.shards > 0
+      ? opts.shards
+      : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  shards_.reserve(n);
+  for (size_t i = 0; i < n; ++i) shards_.push_back(std::make_unique<Shard>());
+}
+
+TournamentManager::~TournamentManager() {
+  // A task holding the last reference to a tournament would otherwise release
+  // the shard's executor from its own thread, once the shard had let go of it.
+  for (auto& shard : shards_) {
+    absl::Notification drained;
+    shard->executor->Schedule([&drained]() { drained.Notify(); });
+    drained.WaitForNotification();
+  }
+}
+
+size_t TournamentManager::ShardIndex(Id id) const {
+  return absl::Hash<Id>()(id) % shards_.size();
+}
+
+absl::StatusOr<std::shared_ptr<TournamentImpl>> TournamentManager::Create(
+    Id id, TournamentImpl::Options opts) {
+  Shard& shard = ShardFor(id);
+  opts.executor = shard.executor;
+  if (!opts.seed.has_value()) opts.seed = Mix(seed_ ^ Mix(id));
+
+  absl::MutexLock l(&shard.mu);
+  auto [it, added] = shard.tournaments.insert({id, Entry()});
+  if (!added) return Err("Tournament ID (", id, ") already exists.");
+  Entry& entry = it->second;
+  entry.tournament = std::make_shared<TournamentImpl>(opts);
+  entry.tournament->Init();
+  entry.opts = std::move(opts);
+  entry.last_access = absl::Now();
+  return entry.tournament;
+}
+
+absl::StatusOr<std::shared_ptr<TournamentImpl>> TournamentManager::Get(
+    Id id) const {
+  Shard& shard = ShardFor(id);
+  std::shared_ptr<Reload> reload;
+  bool loading = false;
+  TournamentImpl::Options opts;
+  {
+    absl::MutexLock l(&shard.mu);
+    auto it = shard.tournaments.find(id);
+    if (it == shard.tournaments.end()) {
+      return Err("No Tournament for ID (", id, ").");
+    }
+    Entry& entry = it->second;
+    entry.last_access = absl::Now();
+    // Cancels any eviction in progress: the caller may change it after it has
+    // been written out.
+    entry.evicting = false;
+    if (entry.tournament != nullptr) return entry.tournament;
+
+    if (entry.reload == nullptr) {
+      entry.reload = std::make_shared<Reload>();
+      opts = entry.opts;
+      loading = true;
+    }
+    reload = entry.reload;
+  }
+  // Someone else is already reading it back in.
+  if (!loading) {
+    reload->done.WaitForNotification();
+    return reload->result;
+  }
+
+  // Read outside the lock, so that only callers for this tournament wait.
+  reload->result = Load(id, opts);
+  {
+    absl::MutexLock l(&shard.mu);
+    auto it = shard.tournaments.find(id);
+    // Unless it was removed meanwhile.
+    if (it != shard.tournaments.end() && it->second.reload == reload) {
+      it->second.reload = nullptr;
+      if (reload->result.ok()) it->second.tournament = *reload->result;
+    }
+  }
+  reload->done.Notify();
+  return reload->result;
+}
+
+std::string TournamentManager::SnapshotPath(Id id) const {
+  return absl::StrCat(snapshot_dir_, "/", id, ".tcgs");
+}
+
+absl::StatusOr<std::shared_ptr<TournamentImpl>> TournamentManager::Load(
+    Id id, const TournamentImpl::Options& opts) const {
+  ScopedLatency timer(MetricOp::kReloadTournament);
+  const std::string path = SnapshotPath(id);
+  auto data = ReadFile(path);
+  if (!data.ok()) return timer.Track(data.status());
+  auto snapshot = DecodeSnapshot(*data);
+  if (!snapshot.ok()) return timer.Track(snapshot.status());
+  auto t = TournamentImpl::Restore(opts, *snapshot);
+  if (!t.ok()) return timer.Track(t.status());
+
+  // The tournament will be written out afresh if evicted again.
+  std::remove(path.c_str());
+  return t;
+}
+
+absl::Status TournamentManager::Remove(Id id) {
+  std::shared_ptr<TournamentImpl> removed;
+  Shard& shard = ShardFor(id);
+  {
+    absl::MutexLock l(&shard.mu);
+    auto it = shard.tournaments.find(id);
+    if (it == shard.tournaments.end()) {
+      return Err("No Tournament for ID (", id, ").");
+    }
+    if (it->second.tournament == nullptr && it->second.reload == nullptr) {
+      std::remove(SnapshotPath(id).c_str());
+    }
+    // Released outside the lock, since it may be the last reference.
+    removed = std::move(it->second.tournament);
+    shard.tournaments.erase(it);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TournamentManager::Schedule(
+    Id id, std::function<void(TournamentImpl&)> fn) {
+  auto t = Get(id);
+  if (!t.ok()) return t.status();
+  ShardFor(id).executor->Schedule(
+      [t = *std::move(t), fn = std::move(fn)]() { fn(*t); });
+  return absl::OkStatus();
+}
+
+std::vector<absl::StatusOr<Round>> TournamentManager::PairNextRounds(
+    absl::Span<const Id> ids, bool generate_standings) {
+  std::vector<absl::StatusOr<Round>> out(
+      ids.size(), absl::UnknownError("Round was not paired."));
+  std::vector<std::vector<size_t>> by_shard(shards_.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    by_shard[ShardIndex(ids[i])].push_back(i);
+  }
+  int busy = 0;
+  for (const auto& indices : by_shard) busy += !indices.empty();
+
+  // Speculative pairings for these rounds may still be queued behind this on
+  // the shard's executor; SpeculativePairer::Take pairs any that have not
+  // started inline rather than waiting on them.
+  absl::BlockingCounter pending(busy);
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    if (by_shard[s].empty()) continue;
+    shards_[s]->executor->Schedule([&, s]() {
+      for (size_t i : by_shard[s]) {
+        auto t = Get(ids[i]);
+        out[i] = t.ok() ? (*t)->PairNextRound(generate_standings) : t.status();
+      }
+      pending.DecrementCount();
+    });
+  }
+  pending.Wait();
+  return out;
+}
+
+absl::StatusOr<size_t> TournamentManager::EvictIdle(absl::Time now) {
+  if (snapshot_dir_.empty()) return Err("No snapshot directory to evict to.");
+
+  // Each shard's pass is queued behind the work already scheduled for its
+  // tournaments, and nothing else of theirs runs while it does.
+  const absl::Time cutoff = now - idle_timeout_;
+  std::vector<size_t> evicted(shards_.size(), 0);
+  std::vector<absl::Status> statuses(shards_.size());
+  absl::BlockingCounter pending(shards_.size());
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    shards_[s]->executor->Schedule([&, s]() {
+      statuses[s] = EvictShard(*shards_[s], cutoff, &evicted[s]);
+      pending.DecrementCount();
+    });
+  }
+  pending.Wait();
+
+  for (const absl::Status& status : statuses) {
+    if (!status.ok()) return status;
+  }
+  size_t total = 0;
+  for (size_t n : evicted) total += n;
+  return total;
+}
+
+absl::Status TournamentManager::EvictShard(Shard& shard, absl::Time cutoff,
+                                           size_t* evicted) {
+  // Marked under the lock, but written out without it, so that lookups of the
+  // shard's other tournaments never wait on the disk.
+  std::vector<std::pair<Id, std::shared_ptr<TournamentImpl>>> marked;
+  {
+    absl::MutexLock l(&shard.mu);
+    for (auto& [id, entry] : shard.tournaments) {
+      const auto& t = entry.tournament;
+      if (t == nullptr || entry.last_access > cutoff) continue;
+      // Checked in this order: anything scheduled for the tournament was
+      // scheduled by someone holding it, and would otherwise be dropped.
+      if (t.use_count() > 1 || t->has_subscribers() ||
+          shard.executor->pending() > 0) {
+        continue;
+      }
+      entry.evicting = true;
+      marked.push_back({id, t});
+    }
+  }
+
+  absl::Status out;
+  std::vector<bool> written(marked.size(), false);
+  for (size_t i = 0; i < marked.size(); ++i) {
+    const auto& [id, t] = marked[i];
+    ScopedLatency timer(MetricOp::kEvictTournament);
+    auto status = timer.Track(
+        WriteFile(SnapshotPath(id), EncodeSnapshot(t->Snapshot())));
+    if (!status.ok() && out.ok()) out = status;
+    written[i] = status.ok();
+  }
+
+  // Released outside the lock.
+  std::vector<std::shared_ptr<TournamentImpl>> released;
+  // Written out, but fetched (or removed) meanwhile.
+  std::vector<Id> stale;
+  {
+    absl::MutexLock l(&shard.mu);
+    for (size_t i = 0; i < marked.size(); ++i) {
+      const auto& [id, t] = marked[i];
+      auto it = shard.tournaments.find(id);
+      const bool kept = it == shard.tournaments.end() ||
+                        !it->second.evicting || it->second.tournament != t;
+      if (!kept) it->second.evicting = false;
+      if (!written[i]) continue;
+      if (kept) {
+        stale.push_back(id);
+        continue;
+      }
+      released.push_back(std::move(it->second.tournament));
+      ++*evicted;
+    }
+  }
+  // Only this shard's thread writes its snapshots, and nothing reads one
+  // back unless its tournament was dropped above.
+  for (Id id : stale) std::remove(SnapshotPath(id).c_str());
+  return out;
+}
+
+std::vector<std::shared_ptr<TournamentImpl>> TournamentManager::All() const {
+  std::vector<std::shared_ptr<TournamentImpl>> out;
+  for (const auto& shard : shards_) {
+    absl::MutexLock l(&shard->mu);
+    for (const auto& [id, entry] : shard->tournaments) {
+      if (entry.tournament != nullptr) out.push_back(entry.tournament);
+    }
+  }
+  return out;
+}
+
+MemoryUsage TournamentManager::GetMemoryUsage() const {
+  MemoryUsage usage;
+  usage.tournament = sizeof(TournamentManager) +
+                     shards_.size() * (sizeof(Shard) + sizeof(Executor));
+  for (const auto& shard : shards_) {
+    absl::MutexLock l(&shard->mu);
+    usage.tournament += HeapBytes(shard->tournaments);
+  }
+  for (const auto& t : All()) usage += t->GetMemoryUsage();
+  return usage;
+}
+
+size_t TournamentManager::size() const {
+  size_t n = 0;
+  for (const auto& shard : shards_) {
+    absl::MutexLock l(&shard->mu);
+    n += shard->tournaments.size();
+  }
+  return n;
+}
+
+size_t TournamentManager::evicted() const {
+  size_t n = 0;
+  for (const auto& shard : shards_) {
+    absl::MutexLock l(&shard->mu);
+    for (const auto& [id, entry] : shard->tournaments) {
+      n += entry.tournament == nullptr;
+    }
+  }
+  return n;
+}
+
+}  // namespace internal
+}  // namespace tcgtc
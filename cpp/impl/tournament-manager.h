@@ -0,0 +1,167 @@
+// This file defines the host for many tournaments in one process, e.g. the
+// hundreds of side events of a big weekend.
+//
+// Tournaments are spread over a fixed number of shards by id. Each shard has
+// its own lock, map and single threaded executor, which runs the background
+// work (standings, speculative pairing, auto-advance) of every tournament on
+// it. However many events are running, the host runs one thread per shard,
+// each event's work stays on one thread, and looking an event up only contends
+// with events on the same shard.
+//
+// Events which go quiet (e.g. finished, or between rounds) can be written out
+// to disk by EvictIdle(), leaving only a stub in memory. The next Get() reads
+// them back in transparently, which is timed as the ReloadTournament op (see
+// cpp/metrics.h).
+
+#ifndef _TCGTC_TOURNAMENT_MANAGER_H_
+#define _TCGTC_TOURNAMENT_MANAGER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "cpp/definitions.h"
+#include "cpp/executor.h"
+#include "cpp/memory-usage.h"
+#include "cpp/impl/tournament.h"
+
+namespace tcgtc {
+namespace internal {
+
+class TournamentManager {
+ public:
+  using Id = uint64_t;
+
+  struct Options {
+    // Number of shards, each with one thread. 0 for one per hardware thread.
+    size_t shards = 0;
+
+    // Seeds every tournament's random number generator, mixed with its id, so
+    // that a tournament's pairings do not depend on the order events were
+    // created in. If unset, seeded from the hardware once.
+    std::optional<uint64_t> seed;
+
+    // Where EvictIdle() writes tournaments out to, one file per tournament.
+    // If empty, tournaments are never evicted.
+    std::string snapshot_dir;
+    // How long a tournament must go without a Get() to be evicted.
+    absl::Duration idle_timeout = absl::Minutes(30);
+  };
+
+  TournamentManager() : TournamentManager(Options()) {}
+  explicit TournamentManager(const Options& opts);
+
+  // Waits for the work already scheduled on every shard.
+  ~TournamentManager();
+
+  TournamentManager(const TournamentManager&) = delete;
+  TournamentManager& operator=(const TournamentManager&) = delete;
+
+  // Creates a tournament on the shard for `id`. The shard's executor replaces
+  // opts.executor, and opts.seed is derived from the manager's seed unless
+  // set. Small events should also shrink opts.event_feed_capacity.
+  absl::StatusOr<std::shared_ptr<TournamentImpl>> Create(
+      Id id, TournamentImpl::Options opts);
+
+  // Reloads the tournament first if it was evicted. Concurrent callers share
+  // the one reload.
+  absl::StatusOr<std::shared_ptr<TournamentImpl>> Get(Id id) const;
+
+  // Forgets the tournament, and deletes its snapshot if evicted. Work already
+  // scheduled for it still runs, and anyone holding it may still use it.
+  absl::Status Remove(Id id);
+
+  // Runs `fn` on the tournament's shard, after any work already scheduled
+  // there.
+  absl::Status Schedule(Id id, std::function<void(TournamentImpl&)> fn);
+
+  // Pairs the next round of each tournament, e.g. when many rounds end at
+  // once. Each shard pairs its own tournaments back to back, so the host pairs
+  // one event per shard at a time rather than one per event. Blocks until all
+  // are done, and returns their results in order. Must not be called from a
+  // shard's thread.
+  std::vector<absl::StatusOr<Round>> PairNextRounds(
+      absl::Span<const Id> ids, bool generate_standings = false);
+
+  // Writes out every tournament not fetched since `now - idle_timeout`, and
+  // drops it from memory. Runs on each shard's thread once its queued work is
+  // done. Tournaments still held elsewhere (including by feed subscribers), or
+  // with work queued, are kept, as are any fetched while being written out.
+  // Returns the number evicted, or the first error writing a snapshot; the
+  // rest are still evicted. Must not be called from a shard's thread.
+  absl::StatusOr<size_t> EvictIdle(absl::Time now = absl::Now());
+
+  // Every loaded tournament's footprint, summed (see
+  // TournamentImpl::GetMemoryUsage). Evicted tournaments only count as stubs.
+  MemoryUsage GetMemoryUsage() const;
+
+  // Including evicted tournaments.
+  size_t size() const;
+  size_t evicted() const;
+  size_t num_shards() const { return shards_.size(); }
+
+ private:
+  // An evicted tournament being read back in.
+  struct Reload {
+    absl::Notification done;
+    // Set before `done` is notified.
+    absl::StatusOr<std::shared_ptr<TournamentImpl>> result;
+  };
+
+  // A tournament, or the stub left when it is evicted.
+  struct Entry {
+    // Null while evicted.
+    std::shared_ptr<TournamentImpl> tournament;
+    // As created with, to restore the tournament with.
+    TournamentImpl::Options opts;
+    absl::Time last_access;
+    // Set while the tournament is being reloaded.
+    std::shared_ptr<Reload> reload;
+    // Set while the tournament is being written out, and cleared by a Get()
+    // meanwhile, which keeps it loaded.
+    bool evicting = false;
+  };
+
+  // Aligned so that one shard's lock never shares a cache line with another's.
+  struct alignas(64) Shard {
+    Shard() : executor(std::make_shared<Executor>(1)) {}
+
+    // Shared with the tournaments on the shard.
+    const std::shared_ptr<Executor> executor;
+    mutable absl::Mutex mu;
+    absl::flat_hash_map<Id, Entry> tournaments ABSL_GUARDED_BY(mu);
+  };
+
+  size_t ShardIndex(Id id) const;
+  Shard& ShardFor(Id id) const { return *shards_[ShardIndex(id)]; }
+  // Loaded tournaments only.
+  std::vector<std::shared_ptr<TournamentImpl>> All() const;
+
+  std::string SnapshotPath(Id id) const;
+  absl::StatusOr<std::shared_ptr<TournamentImpl>> Load(
+      Id id, const TournamentImpl::Options& opts) const;
+  // Runs on the shard's thread. Adds the number evicted to `evicted`.
+  absl::Status EvictShard(Shard& shard, absl::Time cutoff, size_t* evicted);
+
+  const uint64_t seed_;
+  const std::string snapshot_dir_;
+  const absl::Duration idle_timeout_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace internal
+}  // namespace tcgtc
+
+#endif  // _TCGTC_TOURNAMENT_MANAGER_H_
@@ -1,7 +1,11 @@
 #include "cpp/impl/tournament.h"
 
+#include <algorithm>
+
 #include "cpp/player-match.h"
 #include "cpp/impl/round.h"
+#include "cpp/metrics.h"
+#include "cpp/trace.h"
 
 namespace tcgtc {
 namespace internal {
@@ -16,11 +20,36 @@ std::random_device& seeder() {
 }  // namespace
 
 // Tournament ------------------------------------------------------------------
-TournamentImpl::TournamentImpl(const Options& opts)
-  : opts_(opts), rand_(seeder()()) {}
+TournamentImpl::TournamentImpl(const Options& opts, uint64_t first_seq)
+  : opts_(opts), rand_(opts.seed.has_value() ? *opts.seed : seeder()()),
+    feed_(std::make_shared<EventFeed>(opts.event_feed_capacity, first_seq)),
+    executor_(opts.executor),
+    speculator_(opts.speculative_pairing.has_value()
+        ? std::make_unique<SpeculativePairer>(*opts.speculative_pairing)
+        : nullptr),
+    pairing_index_(opts.pairing) {}
+
+Executor& TournamentImpl::executor() const {
+  absl::call_once(executor_once_, [this]() {
+    if (executor_ == nullptr) executor_ = std::make_shared<Executor>(1);
+  });
+  return *executor_;
+}
+
+void TournamentImpl::PublishMatchEvent(EventType type, const Match& m,
+                                       std::optional<MatchResult> result,
+                                       PlayerId player) {
+  TournamentEvent event;
+  event.type = type;
+  event.round = m->id().round;
+  event.match = m->id();
+  event.player = player;
+  event.result = std::move(result);
+  feed_->Publish(event);
+}
 
 absl::StatusOr<Player> TournamentImpl::GetPlayer(Player::Id player) const {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   return GetPlayerLocked(player);
 }
 absl::StatusOr<Player> TournamentImpl::GetPlayerLocked(Player::Id player) const {
@@ -32,20 +61,135 @@ absl::StatusOr<Player> TournamentImpl::GetPlayerLocked(Player::Id player) const
 }
 
 absl::StatusOr<Match> TournamentImpl::GetMatch(MatchId id) const {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   return GetMatchLocked(id);
 }
 absl::StatusOr<Match> TournamentImpl::GetMatchLocked(MatchId id) const {
   if (auto it = matches_.find(id); it != matches_.end()) return it->second;
+  if (auto it = rounds_.find(id.round); it != rounds_.end()) {
+    if (auto compact = it->second->compact(); compact != nullptr) {
+      if (auto m = compact->Find(id.number); m.has_value()) return *m;
+    }
+  }
 
   return Err("No Match in this tournament for id ", id.ErrorStringId());
 }
 
 absl::StatusOr<Round> TournamentImpl::CurrentRound() const {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   return CurrentRoundLocked();
 }
 
+absl::StatusOr<std::shared_ptr<const PairingBoard>>
+TournamentImpl::GetPairingBoard(std::optional<RoundId> round) const {
+  if (!round.has_value()) {
+    if (auto latest = std::atomic_load(&latest_board_); latest != nullptr) {
+      return latest;
+    }
+    return Err("Round 1 has not yet started!");
+  }
+
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  auto r = GetRoundLocked(*round);
+  if (!r.ok()) return r.status();
+  l.Release();
+  if (auto board = (*r)->board(); board != nullptr) return board;
+  return Err((*r)->ErrorStringId(), " has not been published yet.");
+}
+
+absl::StatusOr<std::shared_ptr<const PairingDiagnostics>>
+TournamentImpl::GetPairingDiagnostics(std::optional<RoundId> round) const {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  auto r = round.has_value() ? GetRoundLocked(*round) : CurrentRoundLocked();
+  if (!r.ok()) return r.status();
+  l.Release();
+  if (auto diagnostics = (*r)->diagnostics(); diagnostics != nullptr) {
+    return diagnostics;
+  }
+  return Err((*r)->ErrorStringId(), " has no Swiss pairing diagnostics.");
+}
+
+absl::StatusOr<PairingBoard::Entry> TournamentImpl::FindMatch(
+    Player::Id player, std::optional<RoundId> round) const {
+  auto board = GetPairingBoard(round);
+  if (!board.ok()) return board.status();
+  if (const auto* entry = (*board)->Find(player); entry != nullptr) {
+    return *entry;
+  }
+  return Err("Player ID (", player, ") has no match in Round ",
+             ((*board)->round() & kRoundMask), ".");
+}
+
+MemoryUsage TournamentImpl::GetMemoryUsage() const {
+  MemoryUsage usage;
+  usage.tournament = sizeof(TournamentImpl) + kSharedControlBytes +
+                     sizeof(EventFeed) + feed_->BytesUsed();
+  std::vector<Player> players;
+  std::vector<Match> matches;
+  std::vector<Round> rounds;
+  {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    usage.tournament += HeapBytes(players_) + HeapBytes(active_players_) +
+                        HeapBytes(dropped_players_) + HeapBytes(roster_) +
+                        HeapBytes(matches_) + HeapBytes(pinned_tables_) +
+                        HeapBytes(rounds_);
+    if (roster_copy_ != nullptr) {
+      usage.tournament += sizeof(std::vector<Player>) + kSharedControlBytes +
+                          HeapBytes(*roster_copy_);
+    }
+    players.reserve(players_.size());
+    for (const auto& [id, p] : players_) players.push_back(p);
+    matches.reserve(matches_.size());
+    for (const auto& [id, m] : matches_) matches.push_back(m);
+    for (const auto& [id, r] : rounds_) rounds.push_back(r);
+  }
+  for (const Player& p : players) p->AddMemoryUsage(&usage);
+  usage.matches = matches.size() * Match::Impl::BytesUsed();
+  for (const Round& r : rounds) {
+    usage.rounds += r->BytesUsed();
+    if (auto compact = r->compact(); compact != nullptr) {
+      usage.matches += compact->BytesUsed();
+    }
+  }
+
+  {
+    absl::MutexLock l(&standings_mu_);
+    usage.standings = HeapBytes(standings_);
+    // The latest version is one of these, so is not counted again.
+    for (const auto& [round, standings] : standings_) {
+      usage.standings += standings.BytesUsed();
+    }
+  }
+
+  usage.pairing = sizeof(PairingIndex) + pairing_index_.BytesUsed();
+  if (speculator_ != nullptr) {
+    usage.pairing += sizeof(SpeculativePairer) + speculator_->BytesUsed();
+  }
+  {
+    absl::MutexLock l(&fork_mu_);
+    if (fork_base_ != nullptr) usage.pairing += fork_base_->BytesUsed();
+  }
+  usage.search = sizeof(PlayerSearch) + player_search_.BytesUsed();
+  return usage;
+}
+
+absl::StatusOr<TableMap::Table> TournamentImpl::TableOf(
+    Player::Id player, std::optional<RoundId> round) const {
+  auto entry = FindMatch(player, round);
+  if (!entry.ok()) return entry.status();
+  if (!entry->table.has_value()) {
+    return Err("Player ID (", player, ") has no table in Round ",
+               (entry->match.round & kRoundMask), ".");
+  }
+  return *entry->table;
+}
+
+absl::StatusOr<Round> TournamentImpl::GetRoundLocked(Round::Id id) const {
+  if (auto it = rounds_.find(id); it != rounds_.end()) return it->second;
+
+  return Err("No Round in this tournament for id ", (id & kRoundMask));
+}
+
 // Returns an error status if no rounds have started.
 absl::StatusOr<Round> TournamentImpl::CurrentRoundLocked() const {
   if (rounds_.empty()) return Err("Round 1 has not yet started!");
@@ -53,50 +197,212 @@ absl::StatusOr<Round> TournamentImpl::CurrentRoundLocked() const {
 }
 
 absl::Status TournamentImpl::AddPlayer(const Player::Impl::Options& info) {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   return AddPlayerLocked(info);
 }
 absl::Status
 TournamentImpl::AddPlayerLocked(const Player::Impl::Options& info) {
-  // TODO: Fill this in.
+  if (info.id == kNoPlayer) return Err("Player ID (0) is reserved.");
+  if ((info.first_name.empty() || info.last_name.empty()) &&
+      info.username.empty()) {
+    return Err("Player ID (", info.id, ") needs a full name or a username.");
+  }
+  if (players_.contains(info.id)) {
+    return Err("Player ID (", info.id, ") is already registered.");
+  }
+  if (!rounds_.empty() && !MatchId::IsSwiss(rounds_.rbegin()->first)) {
+    return Err("Cannot add players once elimination rounds start.");
+  }
+  for (const auto& [id, r] : rounds_) {
+    if (!r->paired()) return Err(r->ErrorStringId(), " is still being paired.");
+  }
+
+  // Late entries get a result for each round they missed. Any round not yet
+  // in rounds_ will pair them normally.
+  Player p = Player::Impl::CreatePlayer(info);
+  const bool bye = opts_.late_entry == Options::LateEntry::kAssignedBye;
+  for (const auto& [id, r] : rounds_) {
+    auto m = r->AddAssignedResult(p, bye);
+    if (!m.ok()) return m.status();
+    matches_.insert({(*m)->id(), *m});
+  }
+  // Earlier boards stay as published; the current one shows the entry.
+  if (!rounds_.empty()) PublishBoard(rounds_.rbegin()->second, true);
+
+  players_.insert({info.id, p});
+  active_players_.insert({info.id, p});
+  roster_.push_back(p);
+  pairing_index_.Add(p);
+  pairing_index_.Refresh(p);
+  player_search_.Add(p);
+
+  TournamentEvent event;
+  event.type = EventType::kPlayerAdded;
+  event.player = info.id;
+  feed_->Publish(event);
   return absl::OkStatus();
 }
 
 absl::Status TournamentImpl::DropPlayer(Player::Id player) {
-  absl::MutexLock l(&mu_);
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   return DropPlayerLocked(player);
 }
 absl::Status TournamentImpl::DropPlayerLocked(Player::Id player) {
-  // TODO: Fill this in.
+  auto it = active_players_.find(player);
+  if (it == active_players_.end()) {
+    if (dropped_players_.contains(player)) {
+      return Err("Player ID (", player, ") has already dropped.");
+    }
+    return Err("No Player in this tournament for ID (", player, ").");
+  }
+
+  // Any match the player is already paired in stands; they are just not
+  // paired again.
+  dropped_players_.insert(*it);
+  active_players_.erase(it);
+  pairing_index_.SetActive(player, false);
+  player_search_.SetActive(player, false);
+
+  TournamentEvent event;
+  event.type = EventType::kPlayerDropped;
+  event.player = player;
+  feed_->Publish(event);
+  return absl::OkStatus();
+}
+
+absl::Status TournamentImpl::PinTable(Player::Id player, uint32_t table) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  if (players_.find(player) == players_.end()) {
+    return Err("No Player in this tournament for ID (", player, ").");
+  }
+  pinned_tables_.insert_or_assign(player, table);
+  return absl::OkStatus();
+}
+
+absl::Status TournamentImpl::UnpinTable(Player::Id player) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  if (pinned_tables_.erase(player) == 0) {
+    return Err("Player ID (", player, ") is not pinned to a table.");
+  }
   return absl::OkStatus();
 }
 
+absl::Status TournamentImpl::AddAvoidance(Player::Id player,
+                                          const AvoidanceRule& rule) {
+  {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    if (players_.find(player) == players_.end()) {
+      return Err("No Player in this tournament for ID (", player, ").");
+    }
+    pairing_index_.Avoid(player, rule);
+  }
+  AvoidanceChanged();
+  return absl::OkStatus();
+}
+
+absl::Status TournamentImpl::ClearAvoidance(Player::Id player) {
+  {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    if (players_.find(player) == players_.end()) {
+      return Err("No Player in this tournament for ID (", player, ").");
+    }
+    pairing_index_.ClearAvoidance(player);
+  }
+  AvoidanceChanged();
+  return absl::OkStatus();
+}
+
+void TournamentImpl::PublishBoard(const Round& round, bool if_published) {
+  absl::MutexLock l(&board_mu_);
+  if (if_published && round->board() == nullptr) return;
+  auto tables = round->tables();
+  auto board = std::make_shared<const PairingBoard>(
+      PairingBoard::Build(round->id(), round->Matches(), tables.get()));
+  round->SetBoard(board);
+  auto latest = std::atomic_load(&latest_board_);
+  if (latest == nullptr || latest->round() <= round->id()) {
+    std::atomic_store(&latest_board_, std::move(board));
+  }
+}
+
+void TournamentImpl::AvoidanceChanged() {
+  if (speculator_ != nullptr) speculator_->Clear();
+  // Rule changes are not published, so the fork cache cannot see them.
+  absl::MutexLock l(&fork_mu_);
+  fork_base_ = nullptr;
+  fork_.reset();
+}
+
 std::map<uint32_t, std::vector<Player>> TournamentImpl::ActivePlayers() const {
-  absl::MutexLock l(&mu_);
-  std::map<uint32_t, std::vector<Player>> out;
-  for (const auto& [id, p] : active_players_) {
-    out[p->match_points()].push_back(p);
+  return pairing_index_.Groups();
+}
+
+PartialPairing TournamentImpl::PairActivePlayers(
+    RoundId round, PairingDiagnostics* diagnostics) {
+  return pairing_index_.Pair(round, rand_, diagnostics);
+}
+
+void TournamentImpl::IndexMatch(const Match& m, bool played) {
+  if (!m->is_bye()) {
+    pairing_index_.SetPlayed(m->player_a()->id(), (*m->player_b())->id(),
+                             played);
+    pairing_index_.Refresh(*m->player_b());
   }
-  return out;
+  pairing_index_.Refresh(m->player_a());
+}
+
+absl::Status TournamentImpl::ReportResult(Player::Id player,
+                                          const MatchResult& result) {
+  ScopedLatency timer(MetricOp::kReportResult);
+  return timer.Track(ReportResultInternal(player, result));
 }
 
 // Returns an error status if the result is for a round that is not current.
-absl::Status TournamentImpl::ReportResult(Player::Id player, 
-                                      const MatchResult& result) {
-  absl::ReleasableMutexLock l(&mu_);
+absl::Status TournamentImpl::ReportResultInternal(Player::Id player,
+                                                  const MatchResult& result) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   auto p = GetPlayerLocked(player);
   if (!p.ok()) return p.status();
   auto m = GetMatchLocked(result.id);
   if (!m.ok()) return m.status();
   auto r = GetRoundLocked(result.id.round);
   if (!r.ok()) return r.status();
-  l.Release();
-
   Match match = *std::move(m);
-  if (auto out = match->PlayerReportResult(*p, result); !out.ok()) return out;
+  const bool bracket = match->id().bracket_match();
+  if (bracket) {
+    if (auto out = CheckBracketLocked(result); !out.ok()) return out;
+  } else {
+    l.Release();
+  }
 
-  // If the report confirmed a result, try to commit it to the round.
-  if (match->confirmed_result().ok()) return (*r)->CommitMatchResult(match);
+  std::optional<MatchResult> committed;
+  if (auto out = match->PlayerReportResult(*p, result, &committed); !out.ok()) {
+    return out;
+  }
+  // Not confirmed_result(), whose error for an unconfirmed match allocates.
+  const std::optional<MatchResult> conf = match->results().committed;
+  if (bracket) {
+    auto out = conf.has_value() ? AdvanceBracketLocked(*conf)
+                                : absl::OkStatus();
+    l.Release();
+    if (!out.ok()) return out;
+  }
+  PublishMatchEvent(EventType::kMatchReported, match, result, player);
+
+  // If the report confirmed a result, try to commit it to the round. Only the
+  // report which committed it announces it, not any re-report after.
+  if (conf.has_value()) {
+    if (committed.has_value()) {
+      PublishMatchEvent(EventType::kResultConfirmed, match, *committed);
+    }
+    IndexMatch(match);
+    if (auto out = (*r)->CommitMatchResult(match); !out.ok()) return out;
+    MaybeSpeculate(*r);
+    return absl::OkStatus();
+  }
+  if (match->has_conflict()) {
+    PublishMatchEvent(EventType::kResultConflict, match, std::nullopt);
+  }
   
   // If the report was valid but the first one received, we can't commit but
   // the report is still okay.
@@ -104,37 +410,117 @@ absl::Status TournamentImpl::ReportResult(Player::Id player,
 }
 
 absl::Status TournamentImpl::JudgeSetResult(const MatchResult& result) {
-  absl::ReleasableMutexLock l(&mu_);
+  ScopedLatency timer(MetricOp::kJudgeSetResult);
+  return timer.Track(JudgeSetResultInternal(result));
+}
+
+absl::Status TournamentImpl::JudgeSetResultInternal(const MatchResult& result) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
   auto m = GetMatchLocked(result.id);
   if (!m.ok()) return m.status();
   auto r = GetRoundLocked(result.id.round);
   if (!r.ok()) return r.status();
-  l.Release();
-
   Match match = *std::move(m);
-  if (auto out = match->JudgeSetResult(result); !out.ok()) return out;
-  return (*r)->JudgeSetResult(match);
+  const bool bracket = match->id().bracket_match();
+  if (bracket) {
+    if (auto out = CheckBracketLocked(result); !out.ok()) return out;
+  } else {
+    l.Release();
+  }
+
+  // A compacted round keeps the fix itself; it is already complete.
+  bool compacted = match->compacted();
+  if (!compacted) {
+    auto out = match->JudgeSetResult(result);
+    if (!out.ok() && (bracket || !match->sealed())) return out;
+    if (!out.ok()) {
+      // The (Swiss) round was compacted since the lock was released.
+      // Compaction finishes under the lock, so the match is now found
+      // compacted.
+      TimedMutexLock relock(&mu_, MetricLock::kTournament);
+      auto again = GetMatchLocked(result.id);
+      relock.Release();
+      if (!again.ok()) return again.status();
+      if (!(*again)->compacted()) return out;
+      match = *std::move(again);
+      compacted = true;
+    }
+  }
+  if (compacted) {
+    auto fixed = (*r)->compact()->Correct(result);
+    if (!fixed.ok()) return fixed.status();
+    match = *std::move(fixed);
+  }
+  if (bracket) {
+    auto out = AdvanceBracketLocked(result);
+    l.Release();
+    if (!out.ok()) return out;
+  }
+  PublishMatchEvent(EventType::kJudgeOverride, match, result);
+  IndexMatch(match);
+  if (compacted) return absl::OkStatus();
+  if (auto out = (*r)->JudgeSetResult(match); !out.ok()) return out;
+  MaybeSpeculate(*r);
+  return absl::OkStatus();
+}
+
+void TournamentImpl::MaybeSpeculate(const Round& round) {
+  if (speculator_ == nullptr) return;
+
+  // Elimination rounds are paired from the bracket, not the score groups.
+  if ((round->id() & kRoundMask) >= opts_.swiss_rounds) return;
+
+  auto outstanding = round->OutstandingMatches();
+  if (outstanding.empty() ||
+      outstanding.size() > speculator_->options().max_outstanding) {
+    return;
+  }
+  uint64_t seed;
+  {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    seed = rand_();
+  }
+  // Speculation may finish after the tournament is destroyed.
+  const RoundId next = (round->id() & kRoundMask) + 1;
+  std::weak_ptr<TournamentImpl> self = self_ref();
+  auto pair = [self, next](const ScoreGroups& groups, std::mt19937_64& rand) {
+    if (auto t = self.lock(); t != nullptr) {
+      return t->pairing_index_.Pair(groups, next, rand);
+    }
+    return PartialPairing();
+  };
+  speculator_->Speculate(round->id(), ActivePlayers(), outstanding, seed,
+                         executor(), std::move(pair));
+}
+
+std::optional<PartialPairing> TournamentImpl::TakeSpeculativePairing(
+    const ScoreGroups& groups) {
+  if (speculator_ == nullptr) return std::nullopt;
+  return speculator_->Take(groups);
 }
 
-// For now, require a request to pair the next round, but we can maybe
-// consider doing this automagically when all pairings are received in the
-// previous round.
 absl::StatusOr<Round> TournamentImpl::PairNextRound(bool generate_standings) {
-  absl::ReleasableMutexLock l(&mu_);
+  ScopedLatency timer(MetricOp::kPairNextRound);
+  TraceSpan span("PairNextRound");
+  return timer.Track(PairNextRoundInternal(generate_standings));
+}
+
+absl::StatusOr<Round> TournamentImpl::PairNextRoundInternal(
+    bool generate_standings) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
 
   // Next round number.
+  if (rounds_.size() >= TotalRounds()) return Err("Tournament is complete!");
   RoundId round_num = rounds_.size() + 1;
   if (round_num > opts_.swiss_rounds) round_num |= kBracketBit;
+  std::optional<Round> prev;
+  std::vector<Player> standings_players;
   if (!rounds_.empty()) {
-    Round prev = rounds_.rbegin()->second;
-    if (!prev->RoundComplete()) {
-      return Err(prev->ErrorStringId(), " is not complete!");
-    }
-    if (generate_standings) {
-      auto s = GenerateStandings();
-      if (!s.ok()) return s.status();
-      standings_.insert({round_num, *std::move(s)});
+    prev = rounds_.rbegin()->second;
+    if (!(*prev)->RoundComplete()) {
+      return Err((*prev)->ErrorStringId(), " is not complete!");
     }
+    if (generate_standings) standings_players = AllPlayersLocked();
   }
 
   internal::RoundImpl::Options opts;
@@ -142,33 +528,675 @@ absl::StatusOr<Round> TournamentImpl::PairNextRound(bool generate_standings) {
   opts.parent = self_view();
   Round next = internal::RoundImpl::CreateRound(opts);
   rounds_.insert(std::make_pair(round_num, next));
+  const bool advance = opts_.auto_advance && rounds_.size() < TotalRounds();
   l.Release();
 
-  if (auto out = next->Init(); !out.ok()) return out;
+  // The bracket is seeded from the final Swiss standings, which SeedBracket
+  // publishes itself.
+  const bool first_elimination_round =
+      round_num == ((opts_.swiss_rounds + 1) | kBracketBit);
+  if (first_elimination_round && prev.has_value()) {
+    if (auto out = SeedBracket(*prev); !out.ok()) {
+      TimedMutexLock l(&mu_, MetricLock::kTournament);
+      rounds_.erase(round_num);
+      return out;
+    }
+  }
+
+  // Snapshot before the next round has any matches, so that the standings only
+  // reflect results through the previous round.
+  if (prev.has_value() && generate_standings && !first_elimination_round) {
+    ScheduleStandings(CaptureStandings((*prev)->id(),
+                                       std::move(standings_players)));
+  }
+
+  // A round which failed to pair must not block pairing it again.
+  if (auto out = StartRound(next, advance, EventType::kRoundPaired);
+      !out.ok()) {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    rounds_.erase(round_num);
+    return out;
+  }
+
+  // The previous round's results are now only changed by judges. It is
+  // complete, so compacts; if not, it stays as it is, which is only slower.
+  // N.B. not inside the assert, which is compiled out under NDEBUG.
+  if (prev.has_value()) {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    [[maybe_unused]] auto compacted = CompactLocked(*prev);
+    assert(compacted.ok());
+  }
   return next;
 }
 
-absl::StatusOr<TournamentImpl::Standings>
-TournamentImpl::GenerateStandings() const {
-  std::vector<Standing> standing;
-  standing.reserve(players_.size());
+absl::Status TournamentImpl::StartRound(const Round& next, bool advance,
+                                        EventType type) {
+  {
+    TraceSpan span("pair round");
+    span.AddArg("round", next->id() & kRoundMask);
+    if (auto out = next->Init(); !out.ok()) return out;
+  }
+  auto matches = next->Matches();
+  absl::flat_hash_map<Player::Id, uint32_t> pinned;
+  {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    for (const auto& m : matches) {
+      IndexMatch(m);
+      matches_.insert({m->id(), m});
+    }
+    pinned = pinned_tables_;
+  }
 
+  // Seat the round before announcing it.
+  const std::vector<TableSection> sections = opts_.table_sections.empty()
+      ? std::vector<TableSection>{TableSection{"", opts_.table_one, 0}}
+      : opts_.table_sections;
+  {
+    TraceSpan span("seat tables");
+    span.AddArg("matches", matches.size());
+    next->SetTables(AssignTables(matches, sections, pinned));
+  }
+  {
+    TraceSpan span("publish board");
+    PublishBoard(next);
+  }
+  if (advance) {
+    Tournament::View view = self_view();
+    next->OnComplete([view](Round completed) {
+      if (auto t = view.Lock(); t.ok()) (*t)->AutoAdvance(std::move(completed));
+    });
+  }
+
+  TournamentEvent event;
+  event.type = type;
+  event.round = next->id();
+  feed_->Publish(event);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Round> TournamentImpl::RepairRound() {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  auto current = CurrentRoundLocked();
+  if (!current.ok()) return current.status();
+  const RoundId round_num = (*current)->id();
+  if (!MatchId::IsSwiss(round_num)) {
+    return Err("Elimination rounds cannot be re-paired.");
+  }
+
+  // Check every match can be retired before retiring any, so that a failure
+  // leaves the round as it was.
+  const std::vector<Match> matches = (*current)->Matches();
+  for (const auto& m : matches) {
+    if (auto out = m->CheckRetire(); !out.ok()) return out;
+  }
+
+  // A report in flight may still complete the old round, which must not then
+  // advance the tournament.
+  (*current)->DropOnComplete();
+
+  // Retire under the lock, so that no report can find the old matches once we
+  // start, and none already in flight can commit after its match is retired.
+  for (const auto& m : matches) {
+    if (auto out = m->Retire(); !out.ok()) return out;
+    IndexMatch(m, /*played=*/false);
+    matches_.erase(m->id());
+  }
+
+  // Replace the old round with a fresh one, which is not complete until it is
+  // paired.
+  internal::RoundImpl::Options opts;
+  opts.id = round_num;
+  opts.parent = self_view();
+  Round next = internal::RoundImpl::CreateRound(opts);
+  rounds_.insert_or_assign(round_num, next);
+  const bool advance = opts_.auto_advance && rounds_.size() < TotalRounds();
+  l.Release();
+
+  // Anything speculated was for the discarded pairings.
+  if (speculator_ != nullptr) speculator_->Clear();
+
+  if (auto out = StartRound(next, advance, EventType::kRoundRepaired);
+      !out.ok()) {
+    return out;
+  }
+  return next;
+}
+
+absl::Status TournamentImpl::AutoAdvanceStatus() const {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  return auto_advance_status_;
+}
+
+uint8_t TournamentImpl::TotalRounds() const {
+  return opts_.swiss_rounds + BracketRounds(opts_.bracket);
+}
+
+absl::Status TournamentImpl::SeedBracket(const Round& last_swiss) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  auto players = AllPlayersLocked();
+  l.Release();
+
+  Standings standings = ComputeStandings(
+      CaptureStandings(last_swiss->id(), std::move(players)),
+      opts_.tiebreaks);
+
+  // Only active players make the cut, so look past any dropped players.
+  TimedMutexLock lock(&mu_, MetricLock::kTournament);
+  const size_t cut = static_cast<size_t>(opts_.bracket);
+  std::vector<Player> seeds;
+  seeds.reserve(cut);
+  for (auto& s : standings.TopK(cut + dropped_players_.size())) {
+    if (seeds.size() == cut) break;
+    if (active_players_.contains(s.p->id())) seeds.push_back(std::move(s.p));
+  }
+  auto bracket = Bracket::Create(opts_.bracket, std::move(seeds));
+  if (!bracket.ok()) return bracket.status();
+  bracket_ = *std::move(bracket);
+
+  PublishStandings(std::move(standings));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<Bracket::Pairing>>
+TournamentImpl::BracketPairings(RoundId round) const {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  if (!bracket_.has_value()) return Err("Bracket has not been seeded.");
+  return bracket_->Pairings((round & kRoundMask) - opts_.swiss_rounds);
+}
+
+absl::Status TournamentImpl::CheckBracketLocked(
+    const MatchResult& result) const {
+  if (!result.winner.has_value()) {
+    return Err(result.id.ErrorStringId(), " cannot end in a draw.");
+  }
+  if (!bracket_.has_value()) return Err("Bracket has not been seeded.");
+  // Elimination match numbers are the bracket node plus one.
+  return bracket_->CheckAdvance(result.id.number - 1, *result.winner,
+                                NextRoundPairedLocked(result.id.round));
+}
+
+absl::Status TournamentImpl::AdvanceBracketLocked(const MatchResult& result) {
+  if (auto out = CheckBracketLocked(result); !out.ok()) return out;
+  return bracket_->Advance(result.id.number - 1, *result.winner,
+                           NextRoundPairedLocked(result.id.round));
+}
+
+bool TournamentImpl::NextRoundPairedLocked(RoundId round) const {
+  // Inserted before it is paired, so this also holds while it is pairing.
+  const RoundId next = ((round & kRoundMask) + 1) | kBracketBit;
+  return rounds_.count(next) > 0;
+}
+
+void TournamentImpl::AutoAdvance(Round completed) {
+  // Runs on the thread which committed the last result, so hand the pairing
+  // off rather than making that reporter wait on it.
+  Tournament::View view = self_view();
+  executor().Schedule([view, completed = std::move(completed)]() {
+    auto t = view.Lock();
+    if (!t.ok()) return;
+    Tournament tournament = *std::move(t);
+    {
+      // Someone may have already paired the next round by hand, or re-paired
+      // this one, replacing it with another of the same number.
+      TimedMutexLock l(&tournament->mu_, MetricLock::kTournament);
+      auto current = tournament->CurrentRoundLocked();
+      if (!current.ok() || current->get() != completed.get()) return;
+    }
+    auto next = tournament->PairNextRound(/*generate_standings=*/true);
+    TimedMutexLock l(&tournament->mu_, MetricLock::kTournament);
+    tournament->auto_advance_status_ = next.status();
+  });
+}
+
+std::vector<Player> TournamentImpl::AllPlayersLocked() const {
+  return roster_;
+}
+
+absl::Status TournamentImpl::CompactLocked(const Round& round) {
+  if (roster_copy_ == nullptr || roster_copy_->size() != roster_.size()) {
+    roster_copy_ = std::make_shared<const std::vector<Player>>(roster_);
+  }
+  auto released = round->Compact(roster_copy_);
+  if (!released.ok()) return released.status();
+
+  // The round publishes its block first, so a snapshot which sees a player
+  // let go of their match also finds the round compacted. Every match is let
+  // go of here even if a player fails to, since the round no longer has it.
+  absl::Status status;
+  for (const Match& m : *released) {
+    matches_.erase(m->id());
+    status.Update(m->player_a()->CompactMatch(m));
+    if (!m->is_bye()) status.Update((*m->player_b())->CompactMatch(m));
+  }
+  matches_.rehash(0);
+  return status;
+}
+
+StandingsSnapshot TournamentImpl::CaptureStandings(
+    RoundId round, std::vector<Player> players) const {
+  StandingsSnapshot out = CaptureStandingsSnapshot(round, std::move(players));
+  // Only after the records, so that every round they leave out is found.
+  std::vector<Round> rounds;
+  {
+    TimedMutexLock l(&mu_, MetricLock::kTournament);
+    rounds.reserve(rounds_.size());
+    for (const auto& [id, r] : rounds_) rounds.push_back(r);
+  }
+  for (const Round& r : rounds) {
+    if (auto compact = r->compact(); compact != nullptr) {
+      compact->AddToRecords(&out);
+    }
+  }
+  return out;
+}
+
+absl::Status TournamentImpl::GenerateStandings() {
+  ScopedLatency timer(MetricOp::kGenerateStandings);
+  TraceSpan span("GenerateStandings");
+  return timer.Track(GenerateStandingsInternal());
+}
+
+absl::Status TournamentImpl::GenerateStandingsInternal() {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  auto current = CurrentRoundLocked();
+  if (!current.ok()) return current.status();
+  if (!(*current)->RoundComplete()) {
+    return Err((*current)->ErrorStringId(), " is not complete!");
+  }
+  auto players = AllPlayersLocked();
+  l.Release();
+
+  ScheduleStandings(CaptureStandings((*current)->id(), std::move(players)));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<TournamentImpl::CutForecast>>
+TournamentImpl::ForecastCut(const ForecastOptions& opts) const {
+  ForecastInput input;
+  input.rules = opts_.tiebreaks;
+  input.cut = opts.cut != 0 ? opts.cut : static_cast<size_t>(opts_.bracket);
+  if (input.cut == 0) return Err("Tournament has no cut to forecast.");
+
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  std::optional<Round> current;
+  if (!rounds_.empty()) current = rounds_.rbegin()->second;
+  auto players = AllPlayersLocked();
+  std::vector<Player::Id> active;
+  active.reserve(active_players_.size());
+  for (const auto& [id, p] : active_players_) active.push_back(id);
+  l.Release();
+
+  RoundId round = 0;
+  std::vector<Match> outstanding;
+  if (current.has_value()) {
+    round = (*current)->id();
+    if (!MatchId::IsSwiss(round)) return Err("Swiss rounds are complete.");
+    outstanding = (*current)->OutstandingMatches();
+  }
+  input.remaining_rounds = opts_.swiss_rounds - (round & kRoundMask);
+
+  input.snapshot = CaptureStandings(round, std::move(players));
+  absl::flat_hash_map<Player::Id, uint32_t> index;
+  index.reserve(input.snapshot.players.size());
+  for (uint32_t i = 0; i < input.snapshot.players.size(); ++i) {
+    index.insert({input.snapshot.players[i]->id(), i});
+  }
+  input.active.reserve(active.size());
+  for (Player::Id id : active) {
+    if (auto it = index.find(id); it != index.end()) {
+      input.active.push_back(it->second);
+    }
+  }
+  for (const auto& m : outstanding) {
+    if (m->is_bye()) continue;
+    auto a = index.find(m->player_a()->id());
+    auto b = index.find((*m->player_b())->id());
+    if (a == index.end() || b == index.end()) continue;
+    input.outstanding.push_back({a->second, b->second});
+  }
+
+  // On the tournament's executor, if it was given one, so that forecasts
+  // share its threads rather than each spinning up their own.
+  ForecastOptions run = opts;
+  if (run.executor == nullptr) run.executor = opts_.executor.get();
+  return ::tcgtc::internal::ForecastCut(input, run);
+}
+
+absl::StatusOr<TournamentFork> TournamentImpl::Fork() const {
+  // Read before capturing, so that anything published during the capture
+  // invalidates it.
+  const uint64_t seq = feed_->next_seq();
+  absl::MutexLock fork_lock(&fork_mu_);
+  if (fork_.has_value() && (fork_seq_ == seq || CatchUpForkLocked(seq))) {
+    return *fork_;
+  }
+
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  auto players = AllPlayersLocked();
+  std::vector<Player::Id> active;
+  active.reserve(active_players_.size());
+  for (const auto& [id, p] : active_players_) active.push_back(id);
+  std::vector<Round> rounds;
+  rounds.reserve(rounds_.size());
+  for (const auto& [id, r] : rounds_) rounds.push_back(r);
+  l.Release();
+
+  fork_base_ = nullptr;
+  fork_.reset();
+  if (!rounds.empty() && !MatchId::IsSwiss(rounds.back()->id())) {
+    return Err("Cannot fork a tournament once elimination rounds start.");
+  }
+  fork_base_ = TournamentFork::CaptureBase(
+      std::move(players), active, rounds, pairing_index_.AvoidanceRules(),
+      opts_.swiss_rounds, opts_.tiebreaks);
+  fork_.emplace(fork_base_);
+  fork_seq_ = seq;
+  fork_results_ = 0;
+  return *fork_;
+}
+
+bool TournamentImpl::CatchUpForkLocked(uint64_t seq) const {
+  // Each fork copies the results layered over the base, so past this many it
+  // is cheaper to capture the base again.
+  constexpr uint32_t kMaxForkResults = 256;
+
+  EventFeed::Subscriber events(feed_, fork_seq_);
+  const EventFeed::Batch batch = events.Poll(seq - fork_seq_);
+  // Something was lost, or is still being published.
+  if (batch.missed > 0 || events.cursor() != seq) return false;
+  for (const TournamentEvent& event : batch.events) {
+    switch (event.type) {
+      case EventType::kMatchReported:
+      case EventType::kResultConflict:
+      case EventType::kStandingsPublished:
+        break;
+      case EventType::kResultConfirmed:
+      case EventType::kJudgeOverride:
+        if (!event.result.has_value() || ++fork_results_ > kMaxForkResults) {
+          return false;
+        }
+        // Including a result the base already held, which replaces itself.
+        if (!fork_->SetResult(*event.result).ok()) return false;
+        break;
+      default:
+        return false;
+    }
+  }
+  fork_seq_ = seq;
+  return true;
+}
+
+TournamentSnapshot TournamentImpl::Snapshot() const {
+  TournamentSnapshot out;
+  out.next_seq = feed_->next_seq();
+  const auto avoidance = pairing_index_.AvoidanceRules();
+
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  // A fresh seed, so that the restored tournament does not replay the pairings
+  // drawn so far.
+  out.seed = rand_();
+  out.players.reserve(players_.size());
   for (const auto& [id, p] : players_) {
-    standing.push_back(Standing{0, p, p->ComputeBreakers()});
+    TournamentSnapshot::PlayerEntry entry;
+    entry.info = {id, p->first_name(), p->last_name(), p->username()};
+    entry.dropped = dropped_players_.contains(id);
+    if (auto it = pinned_tables_.find(id); it != pinned_tables_.end()) {
+      entry.pinned_table = it->second;
+    }
+    if (auto it = avoidance.find(id); it != avoidance.end()) {
+      entry.avoidance = it->second;
+    }
+    out.players.push_back(std::move(entry));
+  }
+  std::sort(out.players.begin(), out.players.end(),
+            [](const auto& l, const auto& r) { return l.info.id < r.info.id; });
+
+  std::vector<Round> rounds;
+  rounds.reserve(rounds_.size());
+  for (const auto& [id, r] : rounds_) rounds.push_back(r);
+  if (bracket_.has_value()) {
+    for (const Player& p : bracket_->seeds()) {
+      out.bracket_seeds.push_back(p->id());
+    }
+  }
+  l.Release();
+
+  out.rounds.reserve(rounds.size());
+  for (const Round& r : rounds) {
+    TournamentSnapshot::RoundEntry round;
+    round.id = r->id();
+    auto tables = r->tables();
+    for (const Match& m : r->Matches()) {
+      TournamentSnapshot::MatchEntry entry;
+      entry.id = m->id();
+      entry.a = m->player_a()->id();
+      if (!m->is_bye()) entry.b = (*m->player_b())->id();
+      entry.assigned_loss = m->assigned_loss();
+      auto results = m->results();
+      entry.a_result = results.a;
+      entry.b_result = results.b;
+      entry.committed = results.committed;
+      if (tables != nullptr) entry.table = tables->ForMatch(m->id());
+      round.matches.push_back(std::move(entry));
+    }
+    std::sort(round.matches.begin(), round.matches.end(),
+              [](const auto& l, const auto& r) {
+                return l.id.number < r.id.number;
+              });
+    out.rounds.push_back(std::move(round));
+  }
+
+  absl::MutexLock standings_lock(&standings_mu_);
+  out.standings.reserve(standings_.size());
+  for (const auto& [round, standings] : standings_) {
+    TournamentSnapshot::StandingsEntry entry;
+    entry.round = round;
+    entry.entries.reserve(standings.size());
+    for (const Standing& s : standings.All()) {
+      entry.entries.push_back({s.p->id(), s.info});
+    }
+    out.standings.push_back(std::move(entry));
+  }
+  return out;
+}
+
+absl::StatusOr<std::shared_ptr<TournamentImpl>> TournamentImpl::Restore(
+    Options opts, const TournamentSnapshot& snapshot) {
+  opts.seed = snapshot.seed;
+  std::shared_ptr<TournamentImpl> t(
+      new TournamentImpl(opts, snapshot.next_seq));
+  t->Init();
+  if (auto out = t->RestoreFrom(snapshot); !out.ok()) return out;
+  return t;
+}
+
+absl::Status TournamentImpl::RestoreFrom(const TournamentSnapshot& snapshot) {
+  TimedMutexLock l(&mu_, MetricLock::kTournament);
+  for (const auto& entry : snapshot.players) {
+    Player p = Player::Impl::CreatePlayer(entry.info);
+    const Player::Id id = p->id();
+    if (!players_.insert({id, p}).second) {
+      return Err("Player ID (", id, ") is already registered.");
+    }
+    (entry.dropped ? dropped_players_ : active_players_).insert({id, p});
+    roster_.push_back(p);
+    pairing_index_.Add(p);
+    player_search_.Add(p);
+    if (entry.dropped) {
+      pairing_index_.SetActive(id, false);
+      player_search_.SetActive(id, false);
+    }
+    if (entry.pinned_table.has_value()) {
+      pinned_tables_.insert({id, *entry.pinned_table});
+    }
+    for (const auto& rule : entry.avoidance) pairing_index_.Avoid(id, rule);
+  }
+
+  // Replay each match's reports, then any judge's ruling, so that players'
+  // records and the pairing index end up as they were.
+  const std::vector<TableSection> sections = opts_.table_sections.empty()
+      ? std::vector<TableSection>{TableSection{"", opts_.table_one, 0}}
+      : opts_.table_sections;
+  for (const auto& round : snapshot.rounds) {
+    std::vector<Match> matches;
+    matches.reserve(round.matches.size());
+    absl::flat_hash_map<MatchId, TableMap::Table> tables;
+    for (const auto& entry : round.matches) {
+      auto a = GetPlayerLocked(entry.a);
+      if (!a.ok()) return a.status();
+      std::optional<Match> m;
+      if (entry.b != kNoPlayer) {
+        auto b = GetPlayerLocked(entry.b);
+        if (!b.ok()) return b.status();
+        m = Match::Impl::CreatePairing(*a, *b, entry.id);
+        if (entry.a_result.has_value()) {
+          auto out = (*m)->PlayerReportResult(*a, *entry.a_result);
+          if (!out.ok()) return out;
+        }
+        if (entry.b_result.has_value()) {
+          auto out = (*m)->PlayerReportResult(*b, *entry.b_result);
+          if (!out.ok()) return out;
+        }
+        auto conf = (*m)->confirmed_result();
+        if (entry.committed.has_value() &&
+            (!conf.ok() || *conf != *entry.committed)) {
+          auto out = (*m)->JudgeSetResult(*entry.committed);
+          if (!out.ok()) return out;
+        }
+      } else {
+        m = entry.assigned_loss
+            ? Match::Impl::CreateAssignedLoss(*a, entry.id)
+            : Match::Impl::CreateBye(*a, entry.id);
+      }
+      IndexMatch(*m);
+      matches_.insert({entry.id, *m});
+      if (entry.table.has_value()) tables.insert({entry.id, *entry.table});
+      matches.push_back(*std::move(m));
+    }
+
+    internal::RoundImpl::Options opts;
+    opts.id = round.id;
+    opts.parent = self_view();
+    Round r = internal::RoundImpl::RestoreRound(opts, std::move(matches));
+    r->SetTables(TableMap::Restore(sections, std::move(tables)));
+    rounds_.insert({round.id, r});
+    PublishBoard(r);
+  }
+  // As if each round had been compacted when the next was paired.
+  for (auto it = rounds_.begin(); it != rounds_.end(); ++it) {
+    if (std::next(it) == rounds_.end()) continue;
+    if (auto out = CompactLocked(it->second); !out.ok()) return out;
+  }
+
+  if (!snapshot.bracket_seeds.empty()) {
+    std::vector<Player> seeds;
+    seeds.reserve(snapshot.bracket_seeds.size());
+    for (Player::Id id : snapshot.bracket_seeds) {
+      auto p = GetPlayerLocked(id);
+      if (!p.ok()) return p.status();
+      seeds.push_back(*std::move(p));
+    }
+    auto bracket = Bracket::Create(opts_.bracket, std::move(seeds));
+    if (!bracket.ok()) return bracket.status();
+    bracket_ = *std::move(bracket);
+    for (const auto& round : snapshot.rounds) {
+      if (MatchId::IsSwiss(round.id)) continue;
+      for (const auto& entry : round.matches) {
+        if (!entry.committed.has_value() || !entry.committed->winner) continue;
+        // Elimination match numbers are the bracket node plus one.
+        auto out = bracket_->Advance(entry.id.number - 1,
+                                     *entry.committed->winner);
+        if (!out.ok()) return out;
+      }
+    }
+  }
+
+  std::optional<Round> current;
+  if (opts_.auto_advance && !rounds_.empty() &&
+      rounds_.size() < TotalRounds()) {
+    current = rounds_.rbegin()->second;
+  }
+
+  {
+    absl::MutexLock standings_lock(&standings_mu_);
+    for (const auto& version : snapshot.standings) {
+      std::vector<Standing> entries;
+      entries.reserve(version.entries.size());
+      for (const auto& [id, info] : version.entries) {
+        auto it = players_.find(id);
+        if (it == players_.end()) {
+          return Err("No Player in this tournament for ID (", id, ").");
+        }
+        const TieBreakKey key = WithTieBreakPolicy(
+            opts_.tiebreaks, [&info = info](auto policy) {
+              return decltype(policy)::Key(info);
+            });
+        entries.push_back(Standing{0, it->second, info, key});
+      }
+      standings_[version.round] = Standings(version.round, std::move(entries));
+    }
+    if (!standings_.empty()) {
+      std::atomic_store(&latest_standings_, std::make_shared<const Standings>(
+                                                standings_.rbegin()->second));
+    }
   }
-  std::sort(standing.begin(), standing.end(), [](auto& l, auto& r) {
-    // We want to do GT sorting.
-    return r.info < l.info;
+  l.Release();
+
+  // Auto-advance picks up from the round in progress. A round which completed
+  // before the snapshot has already been advanced from.
+  if (current.has_value() && !(*current)->RoundComplete()) {
+    Tournament::View view = self_view();
+    (*current)->OnComplete([view](Round completed) {
+      if (auto t = view.Lock(); t.ok()) (*t)->AutoAdvance(std::move(completed));
+    });
+  }
+  return absl::OkStatus();
+}
+
+void TournamentImpl::ScheduleStandings(StandingsSnapshot snapshot) {
+  auto shared = std::make_shared<const StandingsSnapshot>(std::move(snapshot));
+  Tournament::View view = self_view();
+  const TieBreakRules rules = opts_.tiebreaks;
+  executor().Schedule([view, shared, rules]() {
+    auto t = view.Lock();
+    if (!t.ok()) return;
+    (*t)->PublishStandings(ComputeStandings(*shared, rules));
   });
+}
 
-  for (uint32_t place = 0; place < standing.size(); ++place) {
-    standing[place].place = place + 1;  // Switch to 1-index.
+void TournamentImpl::PublishStandings(Standings standings) {
+  const RoundId round = standings.round();
+  {
+    absl::MutexLock l(&standings_mu_);
+    auto latest = std::make_shared<const Standings>(standings);
+    standings_[round] = std::move(standings);
+    auto current = std::atomic_load(&latest_standings_);
+    if (current == nullptr || current->round() <= round) {
+      std::atomic_store(&latest_standings_, std::move(latest));
+    }
   }
 
-  auto dst = std::make_shared<std::vector<Standing>>();
-  dst->swap(standing);
+  TournamentEvent event;
+  event.type = EventType::kStandingsPublished;
+  event.round = round;
+  feed_->Publish(event);
+}
+
+absl::StatusOr<TournamentImpl::Standings>
+TournamentImpl::GetStandings(std::optional<RoundId> round) const {
+  if (!round.has_value()) {
+    if (auto latest = std::atomic_load(&latest_standings_); latest != nullptr) {
+      return *latest;
+    }
+    return Err("No standings have been generated yet.");
+  }
 
-  return Standings{std::move(dst)};
+  absl::MutexLock l(&standings_mu_);
+  if (auto it = standings_.find(*round); it != standings_.end()) {
+    return it->second;
+  }
+  return Err("No standings have been generated for Round ",
+             (*round & kRoundMask));
 }
 
 }  // namespace internal
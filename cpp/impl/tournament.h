@@ -1,8 +1,12 @@
 #ifndef _TCGTC_TOURNAMENT_H_
 #define _TCGTC_TOURNAMENT_H_
 
+#include <memory>
+#include <optional>
 #include <random>
+#include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
@@ -10,25 +14,31 @@
 #include "absl/synchronization/mutex.h"
 #include "cpp/container-class.h"
 #include "cpp/definitions.h"
+#include "cpp/event-feed.h"
+#include "cpp/executor.h"
 #include "cpp/match-id.h"
 #include "cpp/match-result.h"
+#include "cpp/memory-usage.h"
 #include "cpp/player-match.h"
+#include "cpp/impl/bracket.h"
+#include "cpp/impl/forecast.h"
+#include "cpp/impl/fork.h"
+#include "cpp/impl/pairing-board.h"
+#include "cpp/impl/player-search.h"
 #include "cpp/impl/round.h"
+#include "cpp/impl/snapshot.h"
+#include "cpp/impl/speculative.h"
+#include "cpp/impl/standings.h"
+#include "cpp/impl/tables.h"
+#include "cpp/pairings/avoidance.h"
+#include "cpp/pairings/isomorphism.h"
+#include "cpp/pairings/pairing-index.h"
 #include "cpp/util.h"
 
 namespace tcgtc {
 namespace internal {
 
-// Currently only support the following bracket sizes.
-enum class BracketSize : uint8_t {
-  kNoBracket = 0,
-  kTop2 = 2,
-  kTop4 = 4,
-  kTop6 = 6,
-  kTop8 = 8,
-};
-
-class TournamentImpl : MemoryManagedImplementation<TournamentImpl> {
+class TournamentImpl : public MemoryManagedImplementation<TournamentImpl> {
  public:
   struct Options {
     uint8_t swiss_rounds = 0;
@@ -36,10 +46,52 @@ class TournamentImpl : MemoryManagedImplementation<TournamentImpl> {
 
     // First table number to use for the tournament.
     uint32_t table_one = 1;
+
+    // Sections of the venue (e.g. halls), filled in order from the top table.
+    // If empty, tables are numbered up from table_one.
+    std::vector<TableSection> table_sections;
+
+    // The rule set used to break ties in the standings.
+    TieBreakRules tiebreaks = TieBreakRules::kMtr;
+
+    // What players entering after Round 1 has been paired get for each round
+    // they missed.
+    enum class LateEntry : uint8_t { kAssignedLoss, kAssignedBye };
+    LateEntry late_entry = LateEntry::kAssignedLoss;
+
+    // Bounds on pairing work per score group. Set these for very large (e.g.
+    // online) events.
+    PairingLimits pairing;
+
+    // Number of events retained for subscribers of the change feed.
+    size_t event_feed_capacity = EventFeed::kDefaultCapacity;
+
+    // If set, pair the next round in the background for each plausible outcome
+    // of the last few outstanding matches of a round.
+    std::optional<SpeculativePairer::Options> speculative_pairing;
+
+    // If set, the next round (and standings) are generated in the background
+    // as soon as the last result of a round is committed, rather than waiting
+    // on a call to PairNextRound.
+    bool auto_advance = false;
+
+    // Runs background work for this tournament. If unset, the tournament
+    // creates its own single threaded executor on first use.
+    std::shared_ptr<Executor> executor;
+
+    // Seeds the tournament's random number generator, e.g. for reproducible
+    // pairings. If unset, it is seeded from the hardware.
+    std::optional<uint64_t> seed;
   };
-  explicit TournamentImpl(const Options& opts);
+  explicit TournamentImpl(const Options& opts) : TournamentImpl(opts, 1) {}
   void Init() { InitSelfPtr(); }
 
+  // Rebuilds a tournament from a snapshot taken with the same options (other
+  // than the executor and seed), replaying every report and result in order.
+  // Subscribers resume from the snapshot's feed sequence number.
+  static absl::StatusOr<std::shared_ptr<TournamentImpl>> Restore(
+      Options opts, const TournamentSnapshot& snapshot);
+
   // Interact with this tournament ---------------------------------------------
   //
   // TODO: For "weird" requests, like adding a player in Round 5, or setting a
@@ -49,29 +101,74 @@ class TournamentImpl : MemoryManagedImplementation<TournamentImpl> {
   absl::Status AddPlayer(const Player::Impl::Options& info);
   absl::Status DropPlayer(Player::Id player);
 
+  // Seats the player at `table` from the next round paired, e.g. for
+  // accessibility or a feature match.
+  absl::Status PinTable(Player::Id player, uint32_t table)
+      ABSL_LOCKS_EXCLUDED(mu_);
+  absl::Status UnpinTable(Player::Id player) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Keeps the player apart from everyone else in the rule's group (see
+  // cpp/pairings/avoidance.h), from the next round paired.
+  absl::Status AddAvoidance(Player::Id player, const AvoidanceRule& rule)
+      ABSL_LOCKS_EXCLUDED(mu_, fork_mu_);
+  absl::Status ClearAvoidance(Player::Id player)
+      ABSL_LOCKS_EXCLUDED(mu_, fork_mu_);
+
   // Returns an error status if the result is for a round that is not current.
   absl::Status ReportResult(Player::Id player, const MatchResult& result);
   absl::Status JudgeSetResult(const MatchResult& result);
 
 
-  // For now, require a request to pair the next round, but we can maybe
-  // consider doing this automagically when all pairings are received in the
-  // previous round.
+  // Pairs the next round. Called automatically when Options::auto_advance is
+  // set, in which case the outcome of the last attempt is kept in
+  // AutoAdvanceStatus().
   absl::StatusOr<Round> PairNextRound(bool generate_standings = false);
+  absl::Status AutoAdvanceStatus() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Discards the current (Swiss) round's pairings, reversing any results
+  // already committed, and pairs the round again, e.g. after a late entry or a
+  // missed drop. Reports for the discarded matches are rejected from the
+  // moment this is called.
+  absl::StatusOr<Round> RepairRound() ABSL_LOCKS_EXCLUDED(mu_);
 
 
   // Returns standings for the specified round, or the most recent standings
-  // generated.
-  struct Standing {
-    int place;
-    Player p;
-    TieBreakInfo info;
-  };
-  struct Standings {
-    std::shared_ptr<const std::vector<Standing>> standings;
-  };
+  // generated. Never blocks on standings generation or on writers.
+  using Standing = ::tcgtc::internal::Standing;
+  using Standings = ::tcgtc::internal::Standings;
   absl::StatusOr<Standings> GetStandings(
-                                std::optional<RoundId> round = std::nullopt);
+      std::optional<RoundId> round = std::nullopt) const
+      ABSL_LOCKS_EXCLUDED(standings_mu_);
+
+  // Generates standings for the current round, if it is complete, in the
+  // background. PairNextRound(true) does this for the previous round.
+  absl::Status GenerateStandings() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Estimates each active player's odds of making the cut by simulating the
+  // rest of the Swiss rounds from the current state, including any results
+  // still outstanding. Runs on its own pool of threads and blocks until done.
+  using CutForecast = ::tcgtc::internal::CutForecast;
+  absl::StatusOr<std::vector<CutForecast>> ForecastCut(
+      const ForecastOptions& opts = {}) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // A fork of the current (Swiss) state of the tournament, for previews which
+  // must not affect the live event. Forks share the state captured for the
+  // first, with the results confirmed since layered on top, until something
+  // other than a result changes (e.g. a round is paired) or enough results
+  // pile up that capturing afresh is cheaper.
+  absl::StatusOr<TournamentFork> Fork() const
+      ABSL_LOCKS_EXCLUDED(mu_, fork_mu_);
+
+
+  // Streams incremental changes to this tournament. Subscribers resume from
+  // `from_seq` (e.g. the last seq they saw + 1), or only see new events if
+  // unset. Slow subscribers never block the tournament.
+  EventFeed::Subscriber Subscribe(
+      std::optional<uint64_t> from_seq = std::nullopt) const {
+    return EventFeed::Subscriber(feed_, from_seq);
+  }
+  // True while any subscriber holds the feed.
+  bool has_subscribers() const { return feed_.use_count() > 1; }
 
 
   // Accessors for information about the running tournament.
@@ -82,13 +179,73 @@ class TournamentImpl : MemoryManagedImplementation<TournamentImpl> {
   absl::StatusOr<Round> CurrentRound() const  // Error if tournament unstarted.
       ABSL_LOCKS_EXCLUDED(mu_);
 
-  // Active (pairable) players, by match points.
-  std::map<uint32_t, std::vector<Player>> ActivePlayers() const
+  // The pairings of `round` by player name, built once when the round was
+  // published. By default the latest round published, which is lock-free.
+  absl::StatusOr<std::shared_ptr<const PairingBoard>> GetPairingBoard(
+      std::optional<RoundId> round = std::nullopt) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // How the Swiss pairing of `round` (by default the current one) went, e.g.
+  // score group sizes, graph density and pair-downs.
+  absl::StatusOr<std::shared_ptr<const PairingDiagnostics>>
+  GetPairingDiagnostics(std::optional<RoundId> round = std::nullopt) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The player's match, opponent and table in `round` (as above). O(1).
+  absl::StatusOr<PairingBoard::Entry> FindMatch(
+      Player::Id player, std::optional<RoundId> round = std::nullopt) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The player's table in `round` (as above). Errors if they have a Bye.
+  absl::StatusOr<TableMap::Table> TableOf(
+      Player::Id player, std::optional<RoundId> round = std::nullopt) const
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Players (including dropped ones) by partial name or username, prefix
+  // matches first. Never waits on the tournament lock.
+  std::vector<PlayerSearch::Hit> SearchPlayers(absl::string_view query,
+                                               size_t limit = 20) const {
+    return player_search_.Search(query, limit);
+  }
+
+  // An estimate of the memory this tournament holds, by what holds it. O(players
+  // + matches + rounds), but only holds the tournament lock to copy the lists
+  // of players, matches and rounds, then takes each object's lock in turn.
+  MemoryUsage GetMemoryUsage() const
+      ABSL_LOCKS_EXCLUDED(mu_, standings_mu_, fork_mu_);
+
+  // Everything Restore() needs to rebuild this tournament. Only consistent if
+  // nothing reports, pairs or publishes standings meanwhile, e.g. when run on
+  // the tournament's executor.
+  TournamentSnapshot Snapshot() const ABSL_LOCKS_EXCLUDED(mu_, standings_mu_);
+
+  // Active (pairable) players, by match points.
+  std::map<uint32_t, std::vector<Player>> ActivePlayers() const;
+
+  // Pairs the active players for `round`, by score group.
+  PartialPairing PairActivePlayers(RoundId round,
+                                   PairingDiagnostics* diagnostics = nullptr);
+
   std::mt19937_64& rand() const { return rand_; }
 
+  // The matches for an elimination round. The bracket is seeded from the final
+  // Swiss standings when the first elimination round is paired.
+  absl::StatusOr<std::vector<Bracket::Pairing>> BracketPairings(
+      RoundId round) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the speculatively precomputed pairing for these score groups, if
+  // there is one.
+  std::optional<PartialPairing> TakeSpeculativePairing(
+      const ScoreGroups& groups);
+
  private:
+  // Numbers the change feed from `first_seq`.
+  TournamentImpl(const Options& opts, uint64_t first_seq);
+
+  // The body of Restore(), on a freshly constructed tournament.
+  absl::Status RestoreFrom(const TournamentSnapshot& snapshot)
+      ABSL_LOCKS_EXCLUDED(mu_, standings_mu_);
+
   Tournament::View self_view() const { 
     return Tournament::CreateView(self_ref());
   }
@@ -97,6 +254,9 @@ class TournamentImpl : MemoryManagedImplementation<TournamentImpl> {
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   absl::Status AddPlayerLocked(const Player::Impl::Options& info)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Brings the pairing index up to date with a match being added (or, if not
+  // `played`, discarded), or its result changing.
+  void IndexMatch(const Match& m, bool played = true);
   absl::StatusOr<Player> GetPlayerLocked(Player::Id player) const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   absl::StatusOr<Match> GetMatchLocked(MatchId player) const
@@ -105,22 +265,131 @@ class TournamentImpl : MemoryManagedImplementation<TournamentImpl> {
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   absl::StatusOr<Round> CurrentRoundLocked() const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
-  absl::StatusOr<Standings> GenerateStandings() const 
+  // In the order they entered.
+  std::vector<Player> AllPlayersLocked() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Compacts a complete round (see cpp/impl/compact-round.h), letting go of
+  // its matches here and in its players. A round which cannot be compacted
+  // (e.g. is not complete) is left as it is, and the reason returned.
+  absl::Status CompactLocked(const Round& round)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // CaptureStandingsSnapshot(), plus the opponents and byes from compacted
+  // rounds.
+  StandingsSnapshot CaptureStandings(RoundId round,
+                                     std::vector<Player> players) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Computes standings from the snapshot on the executor, then publishes them.
+  void ScheduleStandings(StandingsSnapshot snapshot);
+  void PublishStandings(Standings standings)
+      ABSL_LOCKS_EXCLUDED(standings_mu_);
+
+  // Builds and publishes the round's pairing board. If `if_published`, only
+  // replaces a board already published.
+  void PublishBoard(const Round& round, bool if_published = false)
+      ABSL_LOCKS_EXCLUDED(board_mu_);
+
+  // Pairs a round just inserted into rounds_, registers its matches, and
+  // announces it with an event of the given type.
+  absl::Status StartRound(const Round& next, bool advance, EventType type)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The bodies of the public methods of the same name, which time them (see
+  // cpp/metrics.h).
+  absl::Status ReportResultInternal(Player::Id player,
+                                    const MatchResult& result);
+  absl::Status JudgeSetResultInternal(const MatchResult& result);
+  absl::StatusOr<Round> PairNextRoundInternal(bool generate_standings);
+  absl::Status GenerateStandingsInternal() ABSL_LOCKS_EXCLUDED(mu_);
+
+  Executor& executor() const;
+  // Swiss rounds, plus the rounds needed to play out the bracket.
+  uint8_t TotalRounds() const;
+  void AutoAdvance(Round completed) ABSL_LOCKS_EXCLUDED(mu_);
+  absl::Status SeedBracket(const Round& last_swiss) ABSL_LOCKS_EXCLUDED(mu_);
+  // Elimination results are checked against the bracket before they are
+  // written to the match, then advanced, all under mu_, so that a result the
+  // bracket rejects is never recorded.
+  absl::Status CheckBracketLocked(const MatchResult& result) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  absl::Status AdvanceBracketLocked(const MatchResult& result)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // True once the elimination round after `round` exists, so that the winners
+  // of `round` are fixed.
+  bool NextRoundPairedLocked(RoundId round) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void MaybeSpeculate(const Round& round) ABSL_LOCKS_EXCLUDED(mu_);
+  // Drops anything computed under the old avoidance rules.
+  void AvoidanceChanged() ABSL_LOCKS_EXCLUDED(fork_mu_);
+  // Applies the results published since fork_seq_, up to `seq`, to fork_.
+  // Returns false if anything else was published (or was missed), and the
+  // base must be captured again.
+  bool CatchUpForkLocked(uint64_t seq) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(fork_mu_);
+
+  void PublishMatchEvent(EventType type, const Match& m,
+                         std::optional<MatchResult> result,
+                         PlayerId player = 0);
 
   const Options opts_;
   mutable std::mt19937_64 rand_;
 
+  // Lock-free; never guarded by mu_.
+  const std::shared_ptr<EventFeed> feed_;
+
+  mutable absl::once_flag executor_once_;
+  mutable std::shared_ptr<Executor> executor_;
+  const std::unique_ptr<SpeculativePairer> speculator_;
+
   mutable absl::Mutex mu_;
   // Canonical store of player information for all players in the tournament.
   absl::flat_hash_map<Player::Id, Player> players_ ABSL_GUARDED_BY(mu_);
   absl::flat_hash_map<Player::Id, Player> active_players_ ABSL_GUARDED_BY(mu_);
   absl::flat_hash_map<Player::Id, Player> dropped_players_ ABSL_GUARDED_BY(mu_);
+  // Every player, in the order they entered. Compacted rounds number players
+  // by their place here, through a copy shared until someone else enters.
+  std::vector<Player> roster_ ABSL_GUARDED_BY(mu_);
+  std::shared_ptr<const std::vector<Player>> roster_copy_ ABSL_GUARDED_BY(mu_);
+  // Matches not yet compacted (see CompactLocked()).
   absl::flat_hash_map<MatchId, Match> matches_ ABSL_GUARDED_BY(mu_);
+  // Player to table, for players with a fixed seat.
+  absl::flat_hash_map<Player::Id, uint32_t> pinned_tables_ ABSL_GUARDED_BY(mu_);
+  // Mirrors active_players_, their match points and their opponents, for
+  // pairing, and holds the avoidance rules. Internally synchronized.
+  PairingIndex pairing_index_;
+  // Every player, by name. Internally synchronized.
+  PlayerSearch player_search_;
 
 
   std::map<Round::Id, Round> rounds_ ABSL_GUARDED_BY(mu_);
-  std::map<RoundId, Standings> standings_ ABSL_GUARDED_BY(mu_);
+  absl::Status auto_advance_status_ ABSL_GUARDED_BY(mu_);
+  std::optional<Bracket> bracket_ ABSL_GUARDED_BY(mu_);
+
+  // Standings are published independently of mu_, so that neither generating
+  // nor reading them blocks reporting.
+  mutable absl::Mutex standings_mu_ ABSL_ACQUIRED_AFTER(mu_);
+  std::map<RoundId, Standings> standings_ ABSL_GUARDED_BY(standings_mu_);
+  // Only accessed through std::atomic_load/std::atomic_store.
+  std::shared_ptr<const Standings> latest_standings_;
+
+  // Serializes building pairing boards, so that a board built later is never
+  // replaced by one built from an older list of matches.
+  mutable absl::Mutex board_mu_ ABSL_ACQUIRED_AFTER(mu_);
+  // The board of the latest round published. Only accessed through
+  // std::atomic_load/std::atomic_store.
+  std::shared_ptr<const PairingBoard> latest_board_;
+
+  // The state shared by forks, and a fork of it with the results published
+  // since it was captured applied, up to feed sequence number fork_seq_.
+  mutable absl::Mutex fork_mu_ ABSL_ACQUIRED_BEFORE(mu_);
+  mutable uint64_t fork_seq_ ABSL_GUARDED_BY(fork_mu_) = 0;
+  mutable std::shared_ptr<const TournamentFork::Base> fork_base_
+      ABSL_GUARDED_BY(fork_mu_);
+  mutable std::optional<TournamentFork> fork_ ABSL_GUARDED_BY(fork_mu_);
+  // Results applied to fork_ since fork_base_ was captured.
+  mutable uint32_t fork_results_ ABSL_GUARDED_BY(fork_mu_) = 0;
 };
 
 }  // namespace internal
@@ -10,6 +10,9 @@ namespace tcgtc {
 
 using PlayerId = uint64_t;
 
+// The "winner" of an assigned loss, which no player won.
+constexpr PlayerId kNoPlayer = 0;
+
 struct MatchResult {
   MatchId id;
   // May be empty if the match was drawn.
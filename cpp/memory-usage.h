@@ -0,0 +1,113 @@
+// Estimates of the memory held by live objects, for sizing hosts and checking
+// memory-reduction work against real events.
+//
+// Figures are what the containers asked the allocator for, computed from their
+// sizes and capacities rather than measured, so they are cheap enough to take
+// on a live event. Allocator overhead (headers, rounding, fragmentation) is not
+// included, and neither is anything shared with another tournament.
+
+#ifndef _TCGTC_MEMORY_USAGE_H_
+#define _TCGTC_MEMORY_USAGE_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+
+namespace tcgtc {
+
+// A tournament's footprint, by what holds it. In bytes.
+struct MemoryUsage {
+  // The player objects themselves.
+  size_t players = 0;
+  // Players' names, usernames and display names, beyond what fits inline.
+  size_t names = 0;
+  // The match objects, including their reported results.
+  size_t matches = 0;
+  // Each player's own map of their matches and opponents.
+  size_t player_matches = 0;
+  // Each round's match sets, seating, pairing board and pairing diagnostics.
+  size_t rounds = 0;
+  // Every version of the standings kept, including their rank indices.
+  size_t standings = 0;
+  // The pairing index, speculative pairings and the state captured for forks.
+  size_t pairing = 0;
+  // The player search index.
+  size_t search = 0;
+  // The tournament's own maps of players, matches and rounds, and the event
+  // feed.
+  size_t tournament = 0;
+
+  size_t total() const {
+    return players + names + matches + player_matches + rounds + standings +
+           pairing + search + tournament;
+  }
+
+  MemoryUsage& operator+=(const MemoryUsage& o) {
+    players += o.players;
+    names += o.names;
+    matches += o.matches;
+    player_matches += o.player_matches;
+    rounds += o.rounds;
+    standings += o.standings;
+    pairing += o.pairing;
+    search += o.search;
+    tournament += o.tournament;
+    return *this;
+  }
+};
+
+// The control block std::shared_ptr<T>(new T) allocates alongside the object:
+// a vtable pointer and two counts, plus the pointer to the object.
+constexpr size_t kSharedControlBytes = 4 * sizeof(void*);
+// A red-black tree node's links and color, besides its value.
+constexpr size_t kTreeNodeBytes = 4 * sizeof(void*);
+
+// The heap storage each container holds, not counting what its elements hold in
+// turn (or the container object itself).
+inline size_t HeapBytes(const std::string& s) {
+  // Short strings are stored inline.
+  const char* data = s.data();
+  const char* self = reinterpret_cast<const char*>(&s);
+  if (data >= self && data < self + sizeof(s)) return 0;
+  return s.capacity() + 1;
+}
+
+template <typename T, typename A>
+size_t HeapBytes(const std::vector<T, A>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+template <typename T, size_t N, typename A>
+size_t HeapBytes(const absl::InlinedVector<T, N, A>& v) {
+  return v.capacity() > N ? v.capacity() * sizeof(T) : 0;
+}
+
+// One slot and one control byte per bucket, plus the cloned control bytes at
+// the end of the table.
+template <typename K, typename V, typename H, typename E, typename A>
+size_t HeapBytes(const absl::flat_hash_map<K, V, H, E, A>& m) {
+  if (m.capacity() == 0) return 0;
+  return m.capacity() * (sizeof(std::pair<const K, V>) + 1) + 16;
+}
+
+template <typename K, typename V, typename C, typename A>
+size_t HeapBytes(const std::map<K, V, C, A>& m) {
+  return m.size() * (sizeof(std::pair<const K, V>) + kTreeNodeBytes);
+}
+
+// B-tree nodes are kept at least half full, and about three quarters on
+// average.
+template <typename K, typename C, typename A>
+size_t HeapBytes(const absl::btree_set<K, C, A>& s) {
+  return s.size() * sizeof(K) * 4 / 3;
+}
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_MEMORY_USAGE_H_
@@ -0,0 +1,223 @@
+#include "cpp/metrics.h"
+
+#include <algorithm>
+
+#include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
+
+namespace tcgtc {
+namespace {
+// Threads take shards round-robin, in the order they first record.
+size_t ThreadShard() {
+  static std::atomic<size_t> next{0};
+  thread_local const size_t shard =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return shard;
+}
+
+constexpr const char* kOpNames[] = {
+    "ReportResult", "JudgeSetResult", "PairNextRound", "GenerateStandings",
+    "PairChunk", "SimulatePairChunk", "EvictTournament", "ReloadTournament",
+};
+constexpr const char* kLockNames[] = {"tournament", "round", "match", "player"};
+constexpr const char* kMethodNames[] = {"greedy", "blossom", "windowed"};
+
+std::string Seconds(int64_t nanos) { return absl::StrCat(nanos / 1e9); }
+
+void AppendHistogram(std::string& out, const std::string& name,
+                     const std::string& labels,
+                     const LatencyHistogram::Snapshot& s) {
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i + 1 < LatencyHistogram::kBuckets; ++i) {
+    cumulative += s.counts[i];
+    absl::StrAppend(&out, name, "_bucket{", labels, ",le=\"",
+                    Seconds(LatencyHistogram::kFirstBoundNanos << i), "\"} ",
+                    cumulative, "\n");
+  }
+  absl::StrAppend(&out, name, "_bucket{", labels, ",le=\"+Inf\"} ", s.count,
+                  "\n");
+  absl::StrAppend(&out, name, "_sum{", labels, "} ", Seconds(s.sum_nanos),
+                  "\n");
+  absl::StrAppend(&out, name, "_count{", labels, "} ", s.count, "\n");
+}
+}  // namespace
+
+// LatencyHistogram ------------------------------------------------------------
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  const int64_t nanos = std::max<int64_t>(latency.count(), 0);
+  // The smallest i with nanos <= kFirstBoundNanos << i.
+  size_t bucket = nanos <= kFirstBoundNanos
+      ? 0
+      : absl::bit_width(static_cast<uint64_t>(nanos - 1) / kFirstBoundNanos);
+  bucket = std::min(bucket, kBuckets - 1);
+
+  Shard& shard = shards_[ThreadShard() % kShards];
+  shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.sum_nanos.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Read() const {
+  Snapshot out;
+  for (const Shard& shard : shards_) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+      const uint64_t n = shard.counts[i].load(std::memory_order_relaxed);
+      out.counts[i] += n;
+      out.count += n;
+    }
+    out.sum_nanos += shard.sum_nanos.load(std::memory_order_relaxed);
+  }
+  return out;
+}
+
+// Metrics ---------------------------------------------------------------------
+Metrics& Metrics::Global() {
+  static Metrics* metrics = new Metrics();
+  return *metrics;
+}
+
+void Metrics::CountReject(MetricOp op, absl::StatusCode code) {
+  size_t c = static_cast<size_t>(code);
+  if (c >= kStatusCodes) c = static_cast<size_t>(absl::StatusCode::kUnknown);
+  rejects_[static_cast<size_t>(op)][c].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::RecordPairing(const PairingDiagnostics& diagnostics) {
+  constexpr auto kRelaxed = std::memory_order_relaxed;
+  rounds_paired_.fetch_add(1, kRelaxed);
+  uint64_t largest = 0;
+  for (const ChunkDiagnostics& chunk : diagnostics.chunks) {
+    chunks_[static_cast<size_t>(chunk.method)].fetch_add(1, kRelaxed);
+    if (chunk.relaxed) relaxed_chunks_.fetch_add(1, kRelaxed);
+    graph_edges_.fetch_add(chunk.edges, kRelaxed);
+    // Greedy chunks never run the blossom, so have no pairs from it.
+    if (chunk.blossom_pairs > chunk.initial_pairs) {
+      augmented_pairs_.fetch_add(chunk.blossom_pairs - chunk.initial_pairs,
+                                 kRelaxed);
+    }
+    largest = std::max<uint64_t>(largest, chunk.players);
+  }
+  pair_downs_.fetch_add(diagnostics.pair_downs, kRelaxed);
+  byes_.fetch_add(diagnostics.byes, kRelaxed);
+  last_largest_chunk_.store(largest, kRelaxed);
+  last_pairing_nanos_.store(diagnostics.time.count(), kRelaxed);
+}
+
+std::string Metrics::PrometheusText() const {
+  std::string out;
+  absl::StrAppend(&out,
+                  "# HELP tcgtc_op_latency_seconds Latency of tournament "
+                  "operations.\n"
+                  "# TYPE tcgtc_op_latency_seconds histogram\n");
+  for (size_t op = 0; op < kOps; ++op) {
+    AppendHistogram(out, "tcgtc_op_latency_seconds",
+                    absl::StrCat("op=\"", kOpNames[op], "\""),
+                    latency_[op].Read());
+  }
+
+  absl::StrAppend(&out,
+                  "# HELP tcgtc_lock_wait_seconds Time spent waiting to take "
+                  "a lock.\n"
+                  "# TYPE tcgtc_lock_wait_seconds histogram\n");
+  for (size_t lock = 0; lock < kLocks; ++lock) {
+    AppendHistogram(out, "tcgtc_lock_wait_seconds",
+                    absl::StrCat("lock=\"", kLockNames[lock], "\""),
+                    lock_wait_[lock].Read());
+  }
+
+  absl::StrAppend(&out,
+                  "# HELP tcgtc_lock_hold_seconds Time a lock was held.\n"
+                  "# TYPE tcgtc_lock_hold_seconds histogram\n");
+  for (size_t lock = 0; lock < kLocks; ++lock) {
+    AppendHistogram(out, "tcgtc_lock_hold_seconds",
+                    absl::StrCat("lock=\"", kLockNames[lock], "\""),
+                    lock_hold_[lock].Read());
+  }
+
+  absl::StrAppend(&out,
+                  "# HELP tcgtc_rejects_total Requests rejected, by status "
+                  "code.\n"
+                  "# TYPE tcgtc_rejects_total counter\n");
+  for (size_t op = 0; op < kOps; ++op) {
+    for (size_t c = 0; c < kStatusCodes; ++c) {
+      const uint64_t n = rejects_[op][c].load(std::memory_order_relaxed);
+      if (n == 0) continue;
+      absl::StrAppend(
+          &out, "tcgtc_rejects_total{op=\"", kOpNames[op], "\",code=\"",
+          absl::StatusCodeToString(static_cast<absl::StatusCode>(c)), "\"} ",
+          n, "\n");
+    }
+  }
+
+  constexpr auto kRelaxed = std::memory_order_relaxed;
+  auto counter = [&out](const char* name, const char* help, uint64_t value) {
+    absl::StrAppend(&out, "# HELP ", name, " ", help, "\n# TYPE ", name,
+                    " counter\n", name, " ", value, "\n");
+  };
+  auto gauge = [&out](const char* name, const char* help,
+                      const std::string& value) {
+    absl::StrAppend(&out, "# HELP ", name, " ", help, "\n# TYPE ", name,
+                    " gauge\n", name, " ", value, "\n");
+  };
+  counter("tcgtc_pairing_rounds_total", "Swiss rounds paired.",
+          rounds_paired_.load(kRelaxed));
+  absl::StrAppend(&out,
+                  "# HELP tcgtc_pairing_chunks_total Score groups paired, by "
+                  "method.\n"
+                  "# TYPE tcgtc_pairing_chunks_total counter\n");
+  for (size_t m = 0; m < kMethods; ++m) {
+    absl::StrAppend(&out, "tcgtc_pairing_chunks_total{method=\"",
+                    kMethodNames[m], "\"} ", chunks_[m].load(kRelaxed), "\n");
+  }
+  counter("tcgtc_pairing_relaxed_chunks_total",
+          "Score groups paired without their soft constraints.",
+          relaxed_chunks_.load(kRelaxed));
+  counter("tcgtc_pairing_graph_edges_total", "Edges in the graphs matched.",
+          graph_edges_.load(kRelaxed));
+  counter("tcgtc_pairing_augmented_pairs_total",
+          "Pairs the blossom found beyond the initial matching.",
+          augmented_pairs_.load(kRelaxed));
+  counter("tcgtc_pairing_pair_downs_total",
+          "Players carried into a lower score group.",
+          pair_downs_.load(kRelaxed));
+  counter("tcgtc_pairing_byes_total", "Byes given by Swiss pairing.",
+          byes_.load(kRelaxed));
+  gauge("tcgtc_pairing_last_largest_chunk",
+        "Players in the largest score group of the latest round paired.",
+        absl::StrCat(last_largest_chunk_.load(kRelaxed)));
+  gauge("tcgtc_pairing_last_seconds", "Time to pair the latest round.",
+        Seconds(last_pairing_nanos_.load(kRelaxed)));
+  return out;
+}
+
+// TimedMutexLock --------------------------------------------------------------
+TimedMutexLock::TimedMutexLock(absl::Mutex* mu, MetricLock lock)
+    : mu_(mu), lock_(lock), timed_(Metrics::Global().lock_timing()) {
+  if (!timed_) {
+    mu_->Lock();
+    return;
+  }
+  std::chrono::nanoseconds wait{0};
+  if (!mu_->TryLock()) {
+    const auto start = std::chrono::steady_clock::now();
+    mu_->Lock();
+    acquired_ = std::chrono::steady_clock::now();
+    wait = acquired_ - start;
+  } else {
+    acquired_ = std::chrono::steady_clock::now();
+  }
+  Metrics::Global().lock_wait(lock_).Record(wait);
+}
+
+void TimedMutexLock::Release() {
+  absl::Mutex* mu = mu_;
+  mu_ = nullptr;
+  if (!timed_) {
+    mu->Unlock();
+    return;
+  }
+  const auto held = std::chrono::steady_clock::now() - acquired_;
+  mu->Unlock();
+  Metrics::Global().lock_hold(lock_).Record(held);
+}
+
+}  // namespace tcgtc
@@ -0,0 +1,215 @@
+// Process-wide metrics for the hot paths, for finding where the time goes under
+// load:
+//   - Latency histograms for the main tournament operations, and for pairing
+//     each chunk of players, live rounds apart from simulated ones.
+//   - Wait and hold times for the tournament, round, match and player locks,
+//     when turned on (see Metrics::set_lock_timing).
+//   - Rejected requests, by operation and status code.
+//   - Totals over the rounds paired (see cpp/pairings/diagnostics.h), and the
+//     shape of the latest one.
+//
+// Recording is a relaxed atomic increment into a shard picked per thread, so
+// threads recording at once rarely share a cache line, and nothing records
+// under a lock. Metrics::PrometheusText() renders everything in the Prometheus
+// text exposition format, for whatever serves it to a scraper.
+
+#ifndef _TCGTC_METRICS_H_
+#define _TCGTC_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "cpp/pairings/diagnostics.h"
+
+namespace tcgtc {
+
+enum class MetricOp : uint8_t {
+  kReportResult,
+  kJudgeSetResult,
+  kPairNextRound,
+  kGenerateStandings,
+  kPairChunk,
+  // Pairing a chunk of a simulated round (see ScopedSimulation), e.g. for a
+  // forecast, rather than of a round being paired for real.
+  kSimulatePairChunk,
+  // Writing an idle tournament out to disk, and reading it back on next use
+  // (see cpp/impl/tournament-manager.h).
+  kEvictTournament,
+  kReloadTournament,
+  kCount,
+};
+
+enum class MetricLock : uint8_t {
+  kTournament,
+  kRound,
+  kMatch,
+  kPlayer,
+  kCount,
+};
+
+class LatencyHistogram {
+ public:
+  // Bucket i counts latencies up to 256ns * 2^i; the last counts the rest.
+  static constexpr size_t kBuckets = 28;
+  static constexpr int64_t kFirstBoundNanos = 256;
+
+  struct Snapshot {
+    std::array<uint64_t, kBuckets> counts = {};
+    uint64_t count = 0;
+    int64_t sum_nanos = 0;
+  };
+
+  void Record(std::chrono::nanoseconds latency);
+
+  // Sums the shards. Not atomic with respect to concurrent recording.
+  Snapshot Read() const;
+
+ private:
+  static constexpr size_t kShards = 16;
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kBuckets> counts = {};
+    std::atomic<int64_t> sum_nanos{0};
+  };
+  std::array<Shard, kShards> shards_;
+};
+
+class Metrics {
+ public:
+  static Metrics& Global();
+
+  LatencyHistogram& latency(MetricOp op) {
+    return latency_[static_cast<size_t>(op)];
+  }
+  LatencyHistogram& lock_wait(MetricLock lock) {
+    return lock_wait_[static_cast<size_t>(lock)];
+  }
+  LatencyHistogram& lock_hold(MetricLock lock) {
+    return lock_hold_[static_cast<size_t>(lock)];
+  }
+
+  void CountReject(MetricOp op, absl::StatusCode code);
+
+  void RecordPairing(const PairingDiagnostics& diagnostics);
+
+  // Lock timing costs two clock reads per lock taken, so is off by default;
+  // turn it on while investigating contention.
+  bool lock_timing() const {
+    return lock_timing_.load(std::memory_order_relaxed);
+  }
+  void set_lock_timing(bool on) {
+    lock_timing_.store(on, std::memory_order_relaxed);
+  }
+
+  std::string PrometheusText() const;
+
+ private:
+  // Covers every absl::StatusCode in use; anything past it counts as kUnknown.
+  static constexpr size_t kStatusCodes = 17;
+  static constexpr size_t kOps = static_cast<size_t>(MetricOp::kCount);
+  static constexpr size_t kLocks = static_cast<size_t>(MetricLock::kCount);
+
+  std::array<LatencyHistogram, kOps> latency_;
+  std::array<LatencyHistogram, kLocks> lock_wait_;
+  std::array<LatencyHistogram, kLocks> lock_hold_;
+  std::array<std::array<std::atomic<uint64_t>, kStatusCodes>, kOps> rejects_ =
+      {};
+  std::atomic<bool> lock_timing_{false};
+
+  // Pairing totals, and chunks by ChunkDiagnostics::Method.
+  static constexpr size_t kMethods = 3;
+  std::atomic<uint64_t> rounds_paired_{0};
+  std::array<std::atomic<uint64_t>, kMethods> chunks_ = {};
+  std::atomic<uint64_t> relaxed_chunks_{0};
+  std::atomic<uint64_t> graph_edges_{0};
+  // Pairs the blossom found beyond the initial matching.
+  std::atomic<uint64_t> augmented_pairs_{0};
+  std::atomic<uint64_t> pair_downs_{0};
+  std::atomic<uint64_t> byes_{0};
+  // The latest round paired.
+  std::atomic<uint64_t> last_largest_chunk_{0};
+  std::atomic<int64_t> last_pairing_nanos_{0};
+};
+
+// Records the time until it is destroyed as the latency of `op`.
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(MetricOp op)
+      : op_(op), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedLatency() {
+    Metrics::Global().latency(op_).Record(std::chrono::steady_clock::now() -
+                                          start_);
+  }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+  // Counts `out` as a reject of the op if it is an error, and passes it on.
+  absl::Status Track(absl::Status out) const {
+    if (!out.ok()) Metrics::Global().CountReject(op_, out.code());
+    return out;
+  }
+  template <typename T>
+  absl::StatusOr<T> Track(absl::StatusOr<T> out) const {
+    if (!out.ok()) Metrics::Global().CountReject(op_, out.status().code());
+    return out;
+  }
+
+ private:
+  const MetricOp op_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+// Marks pairing on this thread, while alive, as part of a simulation (e.g. a
+// forecast or a fork), so that it is timed as kSimulatePairChunk and leaves
+// kPairChunk to the rounds actually being paired.
+class ScopedSimulation {
+ public:
+  ScopedSimulation() : outer_(active_) { active_ = true; }
+  ~ScopedSimulation() { active_ = outer_; }
+
+  ScopedSimulation(const ScopedSimulation&) = delete;
+  ScopedSimulation& operator=(const ScopedSimulation&) = delete;
+
+  static MetricOp PairChunkOp() {
+    return active_ ? MetricOp::kSimulatePairChunk : MetricOp::kPairChunk;
+  }
+
+ private:
+  static inline thread_local bool active_ = false;
+  const bool outer_;
+};
+
+// absl::ReleasableMutexLock, which also records how long it waited for and
+// held the lock as `lock`. A lock that is free is counted as no wait, without
+// timing the wait.
+class ABSL_SCOPED_LOCKABLE TimedMutexLock {
+ public:
+  TimedMutexLock(absl::Mutex* mu, MetricLock lock)
+      ABSL_EXCLUSIVE_LOCK_FUNCTION(mu);
+  ~TimedMutexLock() ABSL_UNLOCK_FUNCTION() {
+    if (mu_ != nullptr) Release();
+  }
+
+  TimedMutexLock(const TimedMutexLock&) = delete;
+  TimedMutexLock& operator=(const TimedMutexLock&) = delete;
+
+  void Release() ABSL_UNLOCK_FUNCTION();
+
+ private:
+  absl::Mutex* mu_;
+  const MetricLock lock_;
+  const bool timed_;
+  std::chrono::steady_clock::time_point acquired_;
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_METRICS_H_
@@ -0,0 +1,42 @@
+#include "cpp/pairings/avoidance.h"
+
+#include "absl/hash/hash.h"
+
+namespace tcgtc {
+namespace {
+uint64_t GroupBit(uint64_t group) {
+  return uint64_t{1} << (absl::Hash<uint64_t>{}(group) % 64);
+}
+}  // namespace
+
+void CompiledAvoidance::Add(uint32_t item,
+                            const std::vector<AvoidanceRule>& rules) {
+  Entry entry{0, 0, &rules};
+  for (const auto& rule : rules) {
+    if (!rule.AppliesIn(round_)) continue;
+    const uint64_t bit = GroupBit(rule.group);
+    entry.any |= bit;
+    if (rule.strength == Avoidance::kHard) entry.hard |= bit;
+  }
+  if (entry.any == 0) return;
+
+  if (entries_.empty()) entries_.resize(count_);
+  if (entries_[item].any == 0) ++constrained_;
+  entries_[item] = entry;
+}
+
+bool CompiledAvoidance::Shared(uint32_t a, uint32_t b, bool hard_only) const {
+  auto counts = [&](const AvoidanceRule& rule) {
+    return rule.AppliesIn(round_) &&
+           (!hard_only || rule.strength == Avoidance::kHard);
+  };
+  for (const auto& ra : *entries_[a].rules) {
+    if (!counts(ra)) continue;
+    for (const auto& rb : *entries_[b].rules) {
+      if (rb.group == ra.group && counts(rb)) return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace tcgtc
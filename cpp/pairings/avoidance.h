@@ -0,0 +1,87 @@
+// This file defines avoidance rules, which keep players apart when pairing on
+// top of never pairing a rematch: teammates, players from the same store,
+// family members, players on stream.
+//
+// A rule puts one player in a group, and players sharing a group are kept
+// apart. Two players sharing a group by hard rules are never paired; if either
+// rule is soft, they are only paired where keeping them apart would leave more
+// players unpaired in their score group. Rules may lapse after a given round,
+// since most only matter early in an event.
+//
+// For each pairing the rules are compiled to a pair of 64-bit masks per player,
+// one bit per (hashed) group, so the edge filter for almost every pair is a
+// single AND. Groups are only compared when the masks collide.
+
+#ifndef _TCGTC_PAIRINGS_AVOIDANCE_H_
+#define _TCGTC_PAIRINGS_AVOIDANCE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "cpp/match-id.h"
+
+namespace tcgtc {
+
+// Persisted by value (see cpp/impl/snapshot.cc), which only decodes up to
+// kSoft: add new strengths after it, and update the decoder.
+enum class Avoidance : uint8_t {
+  kHard,
+  kSoft,
+};
+
+struct AvoidanceRule {
+  // Chosen by the caller, e.g. a team or store id. To keep two particular
+  // players apart, give them a group of their own.
+  uint64_t group = 0;
+  Avoidance strength = Avoidance::kHard;
+  // The last Swiss round the rule applies in, or 0 for every round.
+  uint8_t through_round = 0;
+
+  bool AppliesIn(RoundId round) const {
+    return through_round == 0 || (round & kRoundMask) <= through_round;
+  }
+};
+
+// The rules in force for pairing one round, over items [0, count).
+class CompiledAvoidance {
+ public:
+  CompiledAvoidance(uint32_t count, RoundId round)
+    : count_(count), round_(round) {}
+
+  // Adds the rules for `item`. `rules` must outlive this object.
+  void Add(uint32_t item, const std::vector<AvoidanceRule>& rules);
+
+  // True if no rules apply this round, so the filters need not be run.
+  bool empty() const { return constrained_ == 0; }
+
+  // True if a and b share a group by hard rules.
+  bool Forbidden(uint32_t a, uint32_t b) const {
+    return !empty() && (entries_[a].hard & entries_[b].hard) != 0 &&
+           Shared(a, b, /*hard_only=*/true);
+  }
+
+  // True if a and b share any group.
+  bool Discouraged(uint32_t a, uint32_t b) const {
+    return !empty() && (entries_[a].any & entries_[b].any) != 0 &&
+           Shared(a, b, /*hard_only=*/false);
+  }
+
+ private:
+  struct Entry {
+    uint64_t hard = 0;
+    uint64_t any = 0;
+    const std::vector<AvoidanceRule>* rules = nullptr;
+  };
+
+  bool Shared(uint32_t a, uint32_t b, bool hard_only) const;
+
+  const uint32_t count_;
+  const RoundId round_;
+  // Allocated on the first Add().
+  std::vector<Entry> entries_;
+  size_t constrained_ = 0;
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_PAIRINGS_AVOIDANCE_H_
@@ -0,0 +1,74 @@
+// This file defines what the pairing engine reports about a round it paired:
+// how big each score group was, how dense its graph, how far the initial
+// matching was from the maximum one, and how long it all took. It is kept with
+// the round, for spotting pathological rounds on real events and measuring
+// changes to the engine against them.
+
+#ifndef _TCGTC_PAIRINGS_DIAGNOSTICS_H_
+#define _TCGTC_PAIRINGS_DIAGNOSTICS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace tcgtc {
+
+// One chunk of players paired together, i.e. one score group and anyone
+// carried down into it.
+struct ChunkDiagnostics {
+  enum class Method : uint8_t {
+    // Everyone (but at most one) was paired greedily, so no graph was built.
+    kGreedy,
+    // A maximum matching of the whole chunk.
+    kBlossom,
+    // Greedily a window at a time, then a maximum matching of what was left
+    // (see PairingLimits).
+    kWindowed,
+  };
+
+  uint32_t points = 0;
+  // Including those carried down.
+  uint32_t players = 0;
+  // Players left unpaired in the group above, and carried into this one.
+  uint32_t carried_in = 0;
+  Method method = Method::kGreedy;
+  // If soft constraints were dropped to pair more players (see avoidance.h).
+  bool relaxed = false;
+
+  // The graph matched, if one was built (i.e. not for kGreedy). For kWindowed,
+  // only the leftovers of the windows are in the graph.
+  uint32_t nodes = 0;
+  uint64_t edges = 0;
+  // Nodes by degree: [0] counts degree 0, and [i] degrees in [2^(i-1), 2^i).
+  std::vector<uint32_t> degrees;
+  // Pairs in the initial matching, and in the maximum matching found from it.
+  uint32_t initial_pairs = 0;
+  uint32_t blossom_pairs = 0;
+  // Pairs made by swapping unpaired players into existing pairs.
+  uint32_t repaired = 0;
+
+  uint32_t pairs = 0;
+  uint32_t unpaired = 0;
+  std::chrono::nanoseconds time{0};
+};
+
+struct PairingDiagnostics {
+  // If the round used a pairing precomputed while the last round finished, in
+  // which case there are no chunks.
+  bool speculative = false;
+  // Top score group first, then any groups re-paired to take in players left
+  // over at the bottom. A group may be paired twice, with and without soft
+  // constraints, in which case only the pairing used is kept.
+  std::vector<ChunkDiagnostics> chunks;
+  // Players paired against (or at least carried into) a lower score group.
+  uint32_t pair_downs = 0;
+  // Players left over below the bottom group, and re-paired with the groups
+  // above.
+  uint32_t pair_ups = 0;
+  uint32_t byes = 0;
+  std::chrono::nanoseconds time{0};
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_PAIRINGS_DIAGNOSTICS_H_
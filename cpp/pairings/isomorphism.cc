@@ -1,8 +1,12 @@
 #include "cpp/pairings/isomorphism.h"
 
+#include <algorithm>
 #include <deque>
+#include <optional>
 
+#include "absl/numeric/bits.h"
 #include "cpp/pairings/blossom.h"
+#include "cpp/trace.h"
 
 namespace tcgtc {
 namespace internal {
@@ -27,55 +31,196 @@ Matching InitialMatching(const std::vector<Node>& nodes) {
   for (int i = 0; i + 1 < q.size(); i += 2) m.Insert(q[i], q[i+1]);
   return m;
 }
+
+// Pairs each element with the first later one it may be paired with. Only
+// returns a pairing if it leaves at most one element unpaired, in which case no
+// larger matching exists and there is no need to build the graph.
+std::optional<BasicPartialPairing<uint32_t>> GreedyPairing(
+    uint32_t count, absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair) {
+  BasicPartialPairing<uint32_t> ret;
+  std::vector<bool> paired(count, false);
+  for (uint32_t i = 0; i < count; ++i) {
+    if (paired[i]) continue;
+    for (uint32_t j = i + 1; j < count; ++j) {
+      if (paired[j] || !may_pair(i, j)) continue;
+      paired[i] = paired[j] = true;
+      ret.paired.push_back({i, j});
+      break;
+    }
+    if (paired[i]) continue;
+    ret.unpaired.push_back(i);
+    if (ret.unpaired.size() > 1) return std::nullopt;
+  }
+  return ret;
+}
+
+// Greedily pairs [0, count) a window at a time, carrying the leftovers of each
+// window into the next, then pairs what is left at the end as a whole.
+BasicPartialPairing<uint32_t> WindowedPairing(
+    uint32_t count, absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair,
+    uint32_t window, ChunkDiagnostics* diagnostics) {
+  BasicPartialPairing<uint32_t> ret;
+  ret.paired.reserve(count / 2);
+  std::vector<uint32_t> items;
+  std::vector<uint32_t> left;
+  std::vector<bool> paired;
+  for (uint32_t start = 0; start < count; start += window) {
+    // Leftovers go first, so they get the widest choice of opponents.
+    items.swap(left);
+    left.clear();
+    const uint32_t end = std::min(count, start + window);
+    for (uint32_t i = start; i < end; ++i) items.push_back(i);
+
+    paired.assign(items.size(), false);
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (paired[i]) continue;
+      for (size_t j = i + 1; j < items.size(); ++j) {
+        if (paired[j] || !may_pair(items[i], items[j])) continue;
+        paired[i] = paired[j] = true;
+        ret.paired.push_back({items[i], items[j]});
+        break;
+      }
+      if (!paired[i]) left.push_back(items[i]);
+    }
+    items.clear();
+  }
+
+  auto rest = PairIndices(left.size(), [&](uint32_t i, uint32_t j) {
+    return may_pair(left[i], left[j]);
+  }, diagnostics);
+  for (const auto& [a, b] : rest.paired) {
+    ret.paired.push_back({left[a], left[b]});
+  }
+  for (uint32_t i : rest.unpaired) ret.unpaired.push_back(left[i]);
+  return ret;
+}
+
+// For two unpaired u and v, and a pair (a, b) among the last `depth` pairs,
+// replaces (a, b) with (u, a) and (v, b) (or (u, b) and (v, a)) if allowed.
+void RepairPairing(BasicPartialPairing<uint32_t>& pairing,
+                   absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair,
+                   uint32_t depth) {
+  auto& pairs = pairing.paired;
+  auto& left = pairing.unpaired;
+  auto swap_in = [&](size_t ui, size_t vi) {
+    const uint32_t u = left[ui];
+    const uint32_t v = left[vi];
+    const size_t last = pairs.size() - std::min<size_t>(depth, pairs.size());
+    for (size_t k = pairs.size(); k-- > last;) {
+      auto [a, b] = pairs[k];
+      if (!(may_pair(u, a) && may_pair(v, b))) std::swap(a, b);
+      if (!(may_pair(u, a) && may_pair(v, b))) continue;
+      pairs[k] = {u, a};
+      pairs.push_back({v, b});
+      // vi > ui, so erasing vi first leaves ui in place.
+      left.erase(left.begin() + vi);
+      left.erase(left.begin() + ui);
+      return true;
+    }
+    return false;
+  };
+
+  bool progress = true;
+  while (progress && left.size() > 1) {
+    progress = false;
+    for (size_t ui = 0; ui < left.size() && !progress; ++ui) {
+      for (size_t vi = ui + 1; vi < left.size() && !progress; ++vi) {
+        progress = swap_in(ui, vi);
+      }
+    }
+  }
+}
 }  // namespace
 
-PartialPairing PairChunkInternal(const std::vector<Player>& players) {
-  std::vector<CanonicalNode> nodes;
-  absl::flat_hash_map<Node, Player> n2p;
-  nodes.reserve(players.size());
-  n2p.reserve(players.size());
-
-  auto player = [&](const Node& n) -> Player {
-    auto it = n2p.find(n);
-    assert(it != n2p.end());
+BasicPartialPairing<uint32_t> PairIndices(
+    uint32_t count, absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair,
+    ChunkDiagnostics* diagnostics) {
+  // Within a score group almost everyone may be paired with almost everyone,
+  // so this usually suffices.
+  {
+    TraceSpan span("greedy");
+    if (auto greedy = GreedyPairing(count, may_pair); greedy.has_value()) {
+      if (diagnostics != nullptr) {
+        diagnostics->method = ChunkDiagnostics::Method::kGreedy;
+      }
+      return *std::move(greedy);
+    }
+  }
+
+  std::vector<CanonicalNode> nodes(count);
+  absl::flat_hash_map<Node, uint32_t> n2i;
+  n2i.reserve(count);
+
+  auto index = [&](const Node& n) -> uint32_t {
+    auto it = n2i.find(n);
+    assert(it != n2i.end());
     return it->second;
   };
 
-  for (const auto& p : players) {
-    auto& canonical = nodes.emplace_back();
-    n2p.insert({canonical.view(), p});
-  }
+  for (uint32_t i = 0; i < count; ++i) n2i.insert({nodes[i].view(), i});
 
   // Initialize the graph edges.
-  for (int i = 0; i < nodes.size(); i++) {
-    auto ni = n2p.find(nodes[i].view());
-    for (int j = 0; j < i; j++) {
-      auto nj = n2p.find(nodes[j].view());
-      // Do not include edges for players that have played before.
-      if (ni->second->has_played_opp(nj->second)) continue;
-      ni->first->AddNeighbor(nj->first);
+  {
+    TraceSpan span("build graph");
+    span.AddArg("nodes", count);
+    for (uint32_t i = 0; i < count; i++) {
+      for (uint32_t j = 0; j < i; j++) {
+        // Do not include edges for players that have played before.
+        if (!may_pair(i, j)) continue;
+        nodes[i]->AddNeighbor(nodes[j].view());
+      }
     }
   }
+  if (diagnostics != nullptr) {
+    diagnostics->method = ChunkDiagnostics::Method::kBlossom;
+    diagnostics->nodes = count;
+    diagnostics->edges = 0;
+    diagnostics->degrees.clear();
+    for (const auto& n : nodes) {
+      const size_t degree = n->neighbors().size();
+      diagnostics->edges += degree;
+      const size_t bucket = degree == 0 ? 0 : absl::bit_width(degree);
+      if (diagnostics->degrees.size() <= bucket) {
+        diagnostics->degrees.resize(bucket + 1, 0);
+      }
+      ++diagnostics->degrees[bucket];
+    }
+    diagnostics->edges /= 2;
+  }
 
-  PartialPairing ret;
+  BasicPartialPairing<uint32_t> ret;
 
   // Trim simple base cases of Nodes with degree 0 from our graph.
   std::vector<Node> graph_nodes;
-  graph_nodes.reserve(players.size());
+  graph_nodes.reserve(count);
   for (const auto& n : nodes) {
     const auto& nbhd = n->neighbors();
     if (nbhd.empty()) { // No legal pairings in this chunk.
-        ret.unpaired.push_back(player(n));
+        ret.unpaired.push_back(index(n));
     } else {
       graph_nodes.push_back(n);
     }
   }
 
   // Seed the Blossom algorithm with an initial matching.
-  Matching initial = InitialMatching(graph_nodes);
+  Matching initial;
+  {
+    TraceSpan span("initial matching");
+    initial = InitialMatching(graph_nodes);
+  }
   Graph g(graph_nodes);
 
-  Matching maximal = Blossom(g, initial);
+  Matching maximal;
+  {
+    TraceSpan span("blossom");
+    span.AddArg("nodes", graph_nodes.size());
+    maximal = Blossom(g, initial);
+  }
+  if (diagnostics != nullptr) {
+    // Both matchings map each matched node to its partner.
+    diagnostics->initial_pairs = initial.edges().size() / 2;
+    diagnostics->blossom_pairs = maximal.edges().size() / 2;
+  }
 
   // Track the pairings we have made, so we don't insert (A,B) and (B,A).
   absl::flat_hash_set<Node> paired;
@@ -83,17 +228,49 @@ PartialPairing PairChunkInternal(const std::vector<Player>& players) {
     if (auto it = maximal.edges().find(n); it != maximal.edges().end()) {
       if (paired.insert(n).second) {  // Only insert the pairing once.
         const Node& adj = it->second;
-        ret.paired.push_back({player(n), player(adj)});
+        ret.paired.push_back({index(n), index(adj)});
         bool inserted = paired.insert(adj).second;
         assert(inserted);
       }
     } else {
-      ret.unpaired.push_back(player(n));
+      ret.unpaired.push_back(index(n));
     }
   }
 
   return ret;
 }
 
+BasicPartialPairing<uint32_t> PairIndices(
+    uint32_t count, absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair,
+    const PairingLimits& limits, ChunkDiagnostics* diagnostics) {
+  BasicPartialPairing<uint32_t> ret;
+  if (limits.window > 0 && count > limits.window) {
+    TraceSpan span("windowed pairing");
+    ret = WindowedPairing(count, may_pair, limits.window, diagnostics);
+    if (diagnostics != nullptr) {
+      diagnostics->method = ChunkDiagnostics::Method::kWindowed;
+    }
+  } else {
+    ret = PairIndices(count, may_pair, diagnostics);
+  }
+  if (limits.repair > 0) {
+    TraceSpan span("repair");
+    span.AddArg("unpaired", ret.unpaired.size());
+    const size_t before = ret.paired.size();
+    RepairPairing(ret, may_pair, limits.repair);
+    if (diagnostics != nullptr) {
+      diagnostics->repaired = ret.paired.size() - before;
+    }
+  }
+  return ret;
+}
+
+PartialPairing PairChunkInternal(const std::vector<Player>& players) {
+  auto may_pair = [](const Player& a, const Player& b) {
+    return !a->has_played_opp(b);
+  };
+  return PairChunkInternal(players, may_pair);
+}
+
 }  // namespace internal
 }  // namespace tcgtc
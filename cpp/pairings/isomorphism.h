@@ -9,20 +9,82 @@
 #define _TCGTC_PAIRINGS_ISOMORPHISM_H_
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
 #include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
+#include "cpp/metrics.h"
+#include "cpp/pairings/diagnostics.h"
+#include "cpp/trace.h"
 #include "cpp/player-match.h"
 #include "cpp/pairings/graph.h"
 
 namespace tcgtc {
 
-struct PartialPairing {
-  std::vector<std::pair<Player, Player>> paired;
-  std::vector<Player> unpaired;
+template <typename T>
+struct BasicPartialPairing {
+  std::vector<std::pair<T, T>> paired;
+  std::vector<T> unpaired;
+};
+using PartialPairing = BasicPartialPairing<Player>;
+
+// Bounds on the work done pairing one chunk, for very large events (e.g. 50k+
+// player online opens), where a single score group can hold tens of thousands
+// of players. The defaults pair each chunk as a whole; something like
+// {1024, 64} keeps pairing near linear in time and memory.
+struct PairingLimits {
+  // If non-zero, larger chunks are paired greedily a window of this many
+  // players at a time, each window's leftovers carried into the next, so no
+  // graph is ever built over more than the few players left over at the end.
+  uint32_t window = 0;
+  // If non-zero, players left unpaired are swapped into up to this many of the
+  // pairs already made, where that pairs two more players.
+  uint32_t repair = 0;
 };
 
 namespace internal {
+// A maximal matching of [0, count), where i and j may be paired iff
+// may_pair(i, j). If `diagnostics` is set, fills in how it was found.
+BasicPartialPairing<uint32_t> PairIndices(
+    uint32_t count, absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair,
+    ChunkDiagnostics* diagnostics = nullptr);
+
+// As above, within `limits`. The edges are never materialized beyond a window.
+BasicPartialPairing<uint32_t> PairIndices(
+    uint32_t count, absl::FunctionRef<bool(uint32_t, uint32_t)> may_pair,
+    const PairingLimits& limits, ChunkDiagnostics* diagnostics = nullptr);
+
+template <typename T, typename MayPair>
+BasicPartialPairing<T> PairChunkInternal(
+    const std::vector<T>& items, MayPair& may_pair,
+    const PairingLimits& limits = {},
+    ChunkDiagnostics* diagnostics = nullptr) {
+  ScopedLatency timer(ScopedSimulation::PairChunkOp());
+  TraceSpan span("pair chunk");
+  span.AddArg("players", items.size());
+  const auto start = std::chrono::steady_clock::now();
+  auto indices = PairIndices(items.size(), [&](uint32_t i, uint32_t j) {
+    return may_pair(items[i], items[j]);
+  }, limits, diagnostics);
+  BasicPartialPairing<T> out;
+  out.paired.reserve(indices.paired.size());
+  for (const auto& [a, b] : indices.paired) {
+    out.paired.push_back({items[a], items[b]});
+  }
+  out.unpaired.reserve(indices.unpaired.size());
+  for (uint32_t i : indices.unpaired) out.unpaired.push_back(items[i]);
+  if (diagnostics != nullptr) {
+    diagnostics->players = items.size();
+    diagnostics->pairs = out.paired.size();
+    diagnostics->unpaired = out.unpaired.size();
+    diagnostics->time = std::chrono::steady_clock::now() - start;
+  }
+  return out;
+}
+
 PartialPairing PairChunkInternal(const std::vector<Player>& players);
 }  // namespace internal
 
@@ -32,6 +94,225 @@ PartialPairing PairChunk(std::vector<Player>& players, URBG& urbg) {
   return internal::PairChunkInternal(players);
 }
 
+// As above, for anything standing in for a player (e.g. the lightweight copies
+// used by simulations), where `may_pair(a, b)` says if a and b may be paired.
+template <typename T, typename MayPair, typename URBG>
+BasicPartialPairing<T> PairChunk(std::vector<T>& items, MayPair& may_pair,
+                                 URBG& urbg, const PairingLimits& limits = {},
+                                 ChunkDiagnostics* diagnostics = nullptr) {
+  std::shuffle(items.begin(), items.end(), urbg);
+  return internal::PairChunkInternal(items, may_pair, limits, diagnostics);
+}
+
+// Active players, by match points.
+template <typename T>
+using BasicScoreGroups = std::map<uint32_t, std::vector<T>>;
+using ScoreGroups = BasicScoreGroups<Player>;
+
+namespace internal {
+// The items at the positions paired and left unpaired.
+template <typename T>
+BasicPartialPairing<T> AtPositions(
+    const std::vector<T>& items, const BasicPartialPairing<uint32_t>& at) {
+  BasicPartialPairing<T> out;
+  out.paired.reserve(at.paired.size());
+  for (const auto& [a, b] : at.paired) {
+    out.paired.push_back({items[a], items[b]});
+  }
+  out.unpaired.reserve(at.unpaired.size());
+  for (uint32_t i : at.unpaired) out.unpaired.push_back(items[i]);
+  return out;
+}
+
+// Pairs `items` by both `may_pair` and `prefer`. If that strands more than one
+// of them, shuffles again and re-pairs, letting some of those stranded be
+// paired against `prefer`: those with the fewest others they may be paired
+// with first, since it is their rules that are in the way, then twice as many,
+// and so on until at most one is left unpaired. Keeps whichever pairing leaves
+// the fewest unpaired. The chunk's time in `diagnostics` covers every attempt.
+template <typename T, typename MayPair, typename Prefer, typename URBG>
+BasicPartialPairing<T> PairPreferring(
+    const std::vector<T>& items, MayPair& may_pair, Prefer& prefer, URBG& urbg,
+    const PairingLimits& limits, ChunkDiagnostics* diagnostics) {
+  // Pair positions in `items`, so that who was stranded survives the shuffle.
+  std::vector<uint32_t> positions(items.size());
+  for (uint32_t i = 0; i < positions.size(); ++i) positions[i] = i;
+  std::vector<bool> relaxed(items.size(), false);
+  auto allowed = [&](uint32_t a, uint32_t b) {
+    return may_pair(items[a], items[b]) &&
+           (relaxed[a] || relaxed[b] || prefer(items[a], items[b]));
+  };
+  auto out = PairChunk(positions, allowed, urbg, limits, diagnostics);
+  if (out.unpaired.size() <= 1) return AtPositions(items, out);
+
+  // Counting a few partners is enough to tell those who have none apart.
+  constexpr uint32_t kEnoughPartners = 16;
+  std::vector<uint32_t> stranded = out.unpaired;
+  std::vector<uint32_t> partners(items.size(), 0);
+  for (uint32_t i : stranded) {
+    for (uint32_t j = 0; j < items.size() && partners[i] < kEnoughPartners;
+         ++j) {
+      partners[i] += j != i && allowed(i, j);
+    }
+  }
+  std::stable_sort(stranded.begin(), stranded.end(),
+                   [&](uint32_t l, uint32_t r) {
+                     return partners[l] < partners[r];
+                   });
+
+  std::chrono::nanoseconds time{0};
+  if (diagnostics != nullptr) time = diagnostics->time;
+  for (size_t done = 0; done < stranded.size() && out.unpaired.size() > 1;) {
+    const size_t next =
+        std::min(stranded.size(), std::max<size_t>(1, 2 * done));
+    for (; done < next; ++done) relaxed[stranded[done]] = true;
+    ChunkDiagnostics chunk;
+    auto attempt = PairChunk(positions, allowed, urbg, limits,
+                             diagnostics != nullptr ? &chunk : nullptr);
+    time += chunk.time;
+    if (attempt.unpaired.size() < out.unpaired.size()) {
+      out = std::move(attempt);
+      if (diagnostics != nullptr) {
+        chunk.relaxed = true;
+        *diagnostics = std::move(chunk);
+      }
+    }
+  }
+  if (diagnostics != nullptr) diagnostics->time = time;
+  return AtPositions(items, out);
+}
+
+// Where each score group's pairs start in the pairing, top group first.
+struct GroupStart {
+  uint32_t points;
+  size_t first_pair;
+};
+
+// More than one player left over below the bottom group have no one there they
+// may play. Rather than give them Byes, re-pairs them with the pairs made in
+// the groups above, merging in one more group at a time from the bottom up,
+// until at most one is left or every group has been merged. `pair(items,
+// chunk)` pairs a merged chunk.
+template <typename T, typename PairFn>
+void PairUp(BasicPartialPairing<T>& final,
+            const std::vector<GroupStart>& starts, PairFn pair,
+            PairingDiagnostics* diagnostics) {
+  for (size_t k = starts.size(); k-- > 0 && final.unpaired.size() > 1;) {
+    const size_t first = starts[k].first_pair;
+    std::vector<T> merged = final.unpaired;
+    merged.reserve(merged.size() + 2 * (final.paired.size() - first));
+    for (size_t i = first; i < final.paired.size(); ++i) {
+      merged.push_back(final.paired[i].first);
+      merged.push_back(final.paired[i].second);
+    }
+    ChunkDiagnostics chunk;
+    auto tmp = pair(merged, diagnostics != nullptr ? &chunk : nullptr);
+    if (tmp.unpaired.size() >= final.unpaired.size()) continue;
+
+    final.paired.erase(final.paired.begin() + first, final.paired.end());
+    for (auto& p : tmp.paired) final.paired.push_back(std::move(p));
+    if (diagnostics != nullptr) {
+      chunk.points = starts[k].points;
+      chunk.carried_in = final.unpaired.size();
+      diagnostics->pair_ups += final.unpaired.size();
+      diagnostics->chunks.push_back(std::move(chunk));
+    }
+    final.unpaired = std::move(tmp.unpaired);
+  }
+}
+}  // namespace internal
+
+// Pairs score groups from the top down, carrying any players left unpaired in
+// a group down into the next one. Any more than one left over at the bottom are
+// paired up into the groups above where they can be (see internal::PairUp), so
+// only players who may play no one remaining are left unpaired. If
+// `diagnostics` is set, adds each group's chunk to it.
+template <typename T, typename MayPair, typename URBG>
+BasicPartialPairing<T> PairScoreGroups(
+    BasicScoreGroups<T> groups, MayPair may_pair, URBG& urbg,
+    const PairingLimits& limits = {},
+    PairingDiagnostics* diagnostics = nullptr) {
+  BasicPartialPairing<T> final;
+  std::vector<internal::GroupStart> starts;
+  starts.reserve(groups.size());
+  for (auto it = groups.rbegin(); it != groups.rend(); ++it) {
+    auto& current = it->second;
+    TraceSpan span("score group");
+    span.AddArg("points", it->first);
+    starts.push_back({it->first, final.paired.size()});
+    ChunkDiagnostics chunk;
+    chunk.points = it->first;
+    chunk.carried_in = final.unpaired.size();
+
+    // Collect any unpaired players from the last attempt.
+    for (auto& p : final.unpaired) current.push_back(std::move(p));
+    auto tmp = PairChunk(current, may_pair, urbg, limits,
+                         diagnostics != nullptr ? &chunk : nullptr);
+
+    // Collect the pairings for this chunk.
+    for (auto& pair : tmp.paired) final.paired.push_back(std::move(pair));
+    final.unpaired.swap(tmp.unpaired);
+    if (diagnostics != nullptr) {
+      diagnostics->pair_downs += chunk.carried_in;
+      diagnostics->chunks.push_back(std::move(chunk));
+    }
+  }
+  internal::PairUp(final, starts, [&](std::vector<T>& items,
+                                      ChunkDiagnostics* chunk) {
+    return PairChunk(items, may_pair, urbg, limits, chunk);
+  }, diagnostics);
+  return final;
+}
+
+// As above, but also honours `prefer(a, b)` (e.g. soft constraints) wherever it
+// costs nothing: only players a group would otherwise leave unpaired may be
+// paired against it (see internal::PairPreferring).
+template <typename T, typename MayPair, typename Prefer, typename URBG>
+BasicPartialPairing<T> PairScoreGroups(
+    BasicScoreGroups<T> groups, MayPair may_pair, Prefer prefer, URBG& urbg,
+    const PairingLimits& limits = {},
+    PairingDiagnostics* diagnostics = nullptr) {
+  BasicPartialPairing<T> final;
+  std::vector<internal::GroupStart> starts;
+  starts.reserve(groups.size());
+  for (auto it = groups.rbegin(); it != groups.rend(); ++it) {
+    auto& current = it->second;
+    TraceSpan span("score group");
+    span.AddArg("points", it->first);
+    starts.push_back({it->first, final.paired.size()});
+    const uint32_t carried_in = final.unpaired.size();
+    for (auto& p : final.unpaired) current.push_back(std::move(p));
+
+    ChunkDiagnostics chunk;
+    auto tmp = internal::PairPreferring(
+        current, may_pair, prefer, urbg, limits,
+        diagnostics != nullptr ? &chunk : nullptr);
+
+    for (auto& pair : tmp.paired) final.paired.push_back(std::move(pair));
+    final.unpaired.swap(tmp.unpaired);
+    if (diagnostics != nullptr) {
+      chunk.points = it->first;
+      chunk.carried_in = carried_in;
+      diagnostics->pair_downs += carried_in;
+      diagnostics->chunks.push_back(std::move(chunk));
+    }
+  }
+  internal::PairUp(final, starts, [&](const std::vector<T>& items,
+                                      ChunkDiagnostics* chunk) {
+    return internal::PairPreferring(items, may_pair, prefer, urbg, limits,
+                                    chunk);
+  }, diagnostics);
+  return final;
+}
+
+template <typename URBG>
+PartialPairing PairScoreGroups(ScoreGroups groups, URBG& urbg) {
+  return PairScoreGroups(std::move(groups), [](const Player& a,
+                                               const Player& b) {
+    return !a->has_played_opp(b);
+  }, urbg);
+}
+
 }  // namespce tcgtc
 
 #endif  // _TCGTC_PAIRINGS_ISOMORPHISM_H_
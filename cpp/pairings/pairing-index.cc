@@ -0,0 +1,215 @@
+#include "cpp/pairings/pairing-index.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace tcgtc {
+
+bool PairingIndex::Add(const Player& p) {
+  absl::MutexLock l(&mu_);
+  const uint32_t slot = slots_.size();
+  if (!by_id_.insert({p->id(), slot}).second) return false;
+  slots_.push_back(Slot{p});
+  played_.emplace_back();
+  Insert(slot);
+  return true;
+}
+
+void PairingIndex::SetActive(Player::Id p, bool active) {
+  absl::MutexLock l(&mu_);
+  auto slot = SlotOf(p);
+  if (!slot.has_value() || slots_[*slot].active == active) return;
+  if (active) {
+    slots_[*slot].active = true;
+    Insert(*slot);
+  } else {
+    Erase(*slot);
+    slots_[*slot].active = false;
+  }
+}
+
+void PairingIndex::Refresh(const Player& p) {
+  absl::MutexLock l(&mu_);
+  auto slot = SlotOf(p->id());
+  if (!slot.has_value()) return;
+  // Read under the lock, so that the last refresh always sees the latest
+  // points, however refreshes for the same player interleave.
+  const uint16_t points = p->match_points();
+  Slot& s = slots_[*slot];
+  if (s.points == points) return;
+  if (!s.active) {
+    s.points = points;
+    return;
+  }
+  Erase(*slot);
+  s.points = points;
+  Insert(*slot);
+}
+
+void PairingIndex::SetPlayed(Player::Id a, Player::Id b, bool played) {
+  absl::MutexLock l(&mu_);
+  auto sa = SlotOf(a);
+  auto sb = SlotOf(b);
+  if (!sa.has_value() || !sb.has_value()) return;
+  for (auto [row, col] : {std::make_pair(*sa, *sb), std::make_pair(*sb, *sa)}) {
+    auto& opps = played_[row];
+    auto it = std::find(opps.begin(), opps.end(), col);
+    if (played && it == opps.end()) {
+      opps.push_back(col);
+    } else if (!played && it != opps.end()) {
+      *it = opps.back();
+      opps.pop_back();
+    }
+  }
+}
+
+bool PairingIndex::Avoid(Player::Id p, const AvoidanceRule& rule) {
+  absl::MutexLock l(&mu_);
+  auto slot = SlotOf(p);
+  if (!slot.has_value()) return false;
+  auto& rules = avoidance_[*slot];
+  for (auto& existing : rules) {
+    if (existing.group == rule.group) {
+      existing = rule;
+      return true;
+    }
+  }
+  rules.push_back(rule);
+  return true;
+}
+
+void PairingIndex::ClearAvoidance(Player::Id p) {
+  absl::MutexLock l(&mu_);
+  if (auto slot = SlotOf(p); slot.has_value()) avoidance_.erase(*slot);
+}
+
+absl::flat_hash_map<Player::Id, std::vector<AvoidanceRule>>
+PairingIndex::AvoidanceRules() const {
+  absl::ReaderMutexLock l(&mu_);
+  absl::flat_hash_map<Player::Id, std::vector<AvoidanceRule>> out;
+  out.reserve(avoidance_.size());
+  for (const auto& [slot, rules] : avoidance_) {
+    out.insert({slots_[slot].p->id(), rules});
+  }
+  return out;
+}
+
+size_t PairingIndex::active() const {
+  absl::ReaderMutexLock l(&mu_);
+  return active_;
+}
+
+size_t PairingIndex::BytesUsed() const {
+  absl::ReaderMutexLock l(&mu_);
+  size_t bytes = HeapBytes(slots_) + HeapBytes(by_id_) + HeapBytes(groups_) +
+                 HeapBytes(played_) + HeapBytes(avoidance_);
+  for (const auto& [points, group] : groups_) bytes += HeapBytes(group);
+  for (const auto& played : played_) bytes += HeapBytes(played);
+  for (const auto& [slot, rules] : avoidance_) bytes += HeapBytes(rules);
+  return bytes;
+}
+
+ScoreGroups PairingIndex::Groups() const {
+  absl::ReaderMutexLock l(&mu_);
+  ScoreGroups out;
+  for (const auto& [points, members] : groups_) {
+    if (members.empty()) continue;
+    auto& group = out[points];
+    group.reserve(members.size());
+    for (uint32_t slot : members) group.push_back(slots_[slot].p);
+  }
+  return out;
+}
+
+PartialPairing PairingIndex::Pair(RoundId round, std::mt19937_64& rand,
+                                  PairingDiagnostics* diagnostics) const {
+  absl::ReaderMutexLock l(&mu_);
+  BasicScoreGroups<uint32_t> groups;
+  for (const auto& [points, members] : groups_) {
+    if (!members.empty()) groups.insert({points, members});
+  }
+  return PairSlots(std::move(groups), round, rand, diagnostics);
+}
+
+PartialPairing PairingIndex::Pair(const ScoreGroups& groups, RoundId round,
+                                  std::mt19937_64& rand) const {
+  absl::ReaderMutexLock l(&mu_);
+  BasicScoreGroups<uint32_t> slot_groups;
+  std::vector<Player> missing;
+  for (const auto& [points, players] : groups) {
+    auto& group = slot_groups[points];
+    group.reserve(players.size());
+    for (const auto& p : players) {
+      if (auto slot = SlotOf(p->id()); slot.has_value()) {
+        group.push_back(*slot);
+      } else {
+        missing.push_back(p);
+      }
+    }
+  }
+  PartialPairing out = PairSlots(std::move(slot_groups), round, rand);
+  for (auto& p : missing) out.unpaired.push_back(std::move(p));
+  return out;
+}
+
+PartialPairing PairingIndex::PairSlots(
+    BasicScoreGroups<uint32_t> groups, RoundId round, std::mt19937_64& rand,
+    PairingDiagnostics* diagnostics) const {
+  CompiledAvoidance avoid(slots_.size(), round);
+  for (const auto& [slot, rules] : avoidance_) avoid.Add(slot, rules);
+
+  // The mutex is held by our caller for the whole pairing.
+  auto may_pair = [&](uint32_t a, uint32_t b) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    return !Played(a, b) && !avoid.Forbidden(a, b);
+  };
+  BasicPartialPairing<uint32_t> slots;
+  if (avoid.empty()) {
+    slots = PairScoreGroups(std::move(groups), may_pair, rand, limits_,
+                            diagnostics);
+  } else {
+    auto apart = [&](uint32_t a, uint32_t b) {
+      return !avoid.Discouraged(a, b);
+    };
+    slots = PairScoreGroups(std::move(groups), may_pair, apart, rand, limits_,
+                            diagnostics);
+  }
+
+  PartialPairing out;
+  out.paired.reserve(slots.paired.size());
+  for (const auto& [a, b] : slots.paired) {
+    out.paired.push_back({slots_[a].p, slots_[b].p});
+  }
+  for (uint32_t slot : slots.unpaired) out.unpaired.push_back(slots_[slot].p);
+  return out;
+}
+
+std::optional<uint32_t> PairingIndex::SlotOf(Player::Id p) const {
+  if (auto it = by_id_.find(p); it != by_id_.end()) return it->second;
+  return std::nullopt;
+}
+
+void PairingIndex::Insert(uint32_t slot) {
+  Slot& s = slots_[slot];
+  auto& group = groups_[s.points];
+  s.pos = group.size();
+  group.push_back(slot);
+  ++active_;
+}
+
+// Swaps the last member of the group into the removed player's position.
+void PairingIndex::Erase(uint32_t slot) {
+  Slot& s = slots_[slot];
+  auto& group = groups_[s.points];
+  const uint32_t last = group.back();
+  group[s.pos] = last;
+  slots_[last].pos = s.pos;
+  group.pop_back();
+  --active_;
+}
+
+bool PairingIndex::Played(uint32_t a, uint32_t b) const {
+  const auto& opps = played_[a];
+  return std::find(opps.begin(), opps.end(), b) != opps.end();
+}
+
+}  // namespace tcgtc
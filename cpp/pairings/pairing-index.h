@@ -0,0 +1,126 @@
+// This file defines the incrementally maintained state Swiss pairing reads: who
+// is still active, the score groups, and who has played whom.
+//
+// An entry, a drop or a result is O(1), and recording (or undoing) a pairing is
+// O(rounds), a scan of the two players' opponent lists, so nothing on the
+// pairing side is rebuilt between rounds, however many players drop or enter.
+// Players are given dense slots in the order they enter, which are never
+// reused. Edges are implicit: anyone may be paired with anyone except the short
+// list of slots they have played, so memory is linear in the number of players.
+//
+// The index also holds each player's avoidance rules (see avoidance.h), which
+// are compiled afresh for each pairing since they may lapse between rounds.
+
+#ifndef _TCGTC_PAIRINGS_PAIRING_INDEX_H_
+#define _TCGTC_PAIRINGS_PAIRING_INDEX_H_
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/synchronization/mutex.h"
+#include "cpp/match-id.h"
+#include "cpp/memory-usage.h"
+#include "cpp/pairings/avoidance.h"
+#include "cpp/pairings/isomorphism.h"
+#include "cpp/player-match.h"
+
+namespace tcgtc {
+
+class PairingIndex {
+ public:
+  explicit PairingIndex(const PairingLimits& limits = {}) : limits_(limits) {}
+
+  // Adds an active player with no match points. O(1) amortized. Returns false
+  // if the player is already present.
+  bool Add(const Player& p) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Removes the player from (or returns them to) the score groups. O(1).
+  void SetActive(Player::Id p, bool active) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Moves the player to the score group for their current match points. Call
+  // after any change to them. O(1).
+  void Refresh(const Player& p) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records that a and b have (or, if a pairing is undone, have not) played.
+  // O(rounds).
+  void SetPlayed(Player::Id a, Player::Id b, bool played)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Adds an avoidance rule for the player, replacing any rule they already have
+  // for that group. Returns false if the player is not present.
+  bool Avoid(Player::Id p, const AvoidanceRule& rule) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Removes all of the player's avoidance rules.
+  void ClearAvoidance(Player::Id p) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Every player's avoidance rules.
+  absl::flat_hash_map<Player::Id, std::vector<AvoidanceRule>> AvoidanceRules()
+      const ABSL_LOCKS_EXCLUDED(mu_);
+
+  size_t active() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The heap storage held, in bytes (see cpp/memory-usage.h).
+  size_t BytesUsed() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Active players, by match points.
+  ScoreGroups Groups() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Pairs the active players for `round`. Never pairs two who have already
+  // played or who share a hard avoidance group, and keeps those sharing a soft
+  // one apart where that leaves no more players unpaired. If `diagnostics` is
+  // set, adds each score group's chunk to it.
+  PartialPairing Pair(RoundId round, std::mt19937_64& rand,
+                      PairingDiagnostics* diagnostics = nullptr) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // As above, from hypothetical score groups (e.g. when speculating on the
+  // results still outstanding). Players not in the index are left unpaired.
+  PartialPairing Pair(const ScoreGroups& groups, RoundId round,
+                      std::mt19937_64& rand) const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Slot {
+    Player p;
+    bool active = true;
+    uint16_t points = 0;
+    // Position within groups_[points], if active.
+    uint32_t pos = 0;
+  };
+
+  std::optional<uint32_t> SlotOf(Player::Id p) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+  void Insert(uint32_t slot) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void Erase(uint32_t slot) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  bool Played(uint32_t a, uint32_t b) const ABSL_SHARED_LOCKS_REQUIRED(mu_);
+  PartialPairing PairSlots(BasicScoreGroups<uint32_t> groups, RoundId round,
+                           std::mt19937_64& rand,
+                           PairingDiagnostics* diagnostics = nullptr) const
+      ABSL_SHARED_LOCKS_REQUIRED(mu_);
+
+  const PairingLimits limits_;
+
+  mutable absl::Mutex mu_;
+  std::vector<Slot> slots_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<Player::Id, uint32_t> by_id_ ABSL_GUARDED_BY(mu_);
+  // Active slots, by match points. Unordered within a group.
+  absl::flat_hash_map<uint16_t, std::vector<uint32_t>> groups_
+      ABSL_GUARDED_BY(mu_);
+  size_t active_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // The slots each slot has played, unordered. A player only meets a handful
+  // of opponents, so a scan beats a bit-matrix row of one bit per player.
+  std::vector<absl::InlinedVector<uint32_t, 8>> played_ ABSL_GUARDED_BY(mu_);
+
+  // Avoidance rules, by slot. Only players with rules have an entry.
+  absl::flat_hash_map<uint32_t, std::vector<AvoidanceRule>> avoidance_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_PAIRINGS_PAIRING_INDEX_H_
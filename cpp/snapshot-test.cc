@@ -0,0 +1,104 @@
+// Holds snapshots (see cpp/impl/snapshot.h) to reading back exactly what was
+// written, and to rejecting anything cut short or out of range as DataLoss.
+
+#include "cpp/impl/snapshot.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "cpp/impl/round.h"
+#include "cpp/impl/tournament.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+
+constexpr uint64_t kPlayers = 8;
+
+class SnapshotTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    opts_.swiss_rounds = 3;
+    tournament_ = std::make_shared<TournamentImpl>(opts_);
+    tournament_->Init();
+    for (uint64_t id = 1; id <= kPlayers; ++id) {
+      ASSERT_TRUE(tournament_
+                      ->AddPlayer({id, "First", absl::StrCat("Last", id), ""})
+                      .ok());
+    }
+    const AvoidanceRule rule{/*group=*/7, Avoidance::kSoft};
+    ASSERT_TRUE(tournament_->AddAvoidance(1, rule).ok());
+    ASSERT_TRUE(tournament_->AddAvoidance(2, rule).ok());
+
+    // A finished (so compacted) round, and one with a single report in.
+    auto round = tournament_->PairNextRound();
+    ASSERT_TRUE(round.ok()) << round.status();
+    for (const Match& m : (*round)->OutstandingMatches()) {
+      MatchResult result{m->id(), m->player_a()->id(), 2, 1};
+      ASSERT_TRUE(tournament_->JudgeSetResult(result).ok());
+    }
+    round = tournament_->PairNextRound();
+    ASSERT_TRUE(round.ok()) << round.status();
+    const Match m = (*round)->OutstandingMatches().front();
+    reported_ = m->id();
+    MatchResult result{m->id(), m->player_a()->id(), 2, 0};
+    ASSERT_TRUE(tournament_->ReportResult(m->player_a()->id(), result).ok());
+
+    encoded_ = EncodeSnapshot(tournament_->Snapshot());
+  }
+
+  TournamentImpl::Options opts_;
+  std::shared_ptr<TournamentImpl> tournament_;
+  MatchId reported_ = {0, 0};
+  std::string encoded_;
+};
+
+TEST_F(SnapshotTest, RoundTrip) {
+  auto decoded = DecodeSnapshot(encoded_);
+  ASSERT_TRUE(decoded.ok()) << decoded.status();
+  EXPECT_EQ(EncodeSnapshot(*decoded), encoded_);
+
+  ASSERT_EQ(decoded->players.size(), kPlayers);
+  ASSERT_EQ(decoded->players[0].avoidance.size(), 1);
+  EXPECT_EQ(decoded->players[0].avoidance[0].strength, Avoidance::kSoft);
+  ASSERT_EQ(decoded->rounds.size(), 2);
+  EXPECT_EQ(decoded->rounds[0].matches.size(), kPlayers / 2);
+  for (const auto& m : decoded->rounds[0].matches) {
+    EXPECT_TRUE(m.committed.has_value()) << m.id.ErrorStringId();
+  }
+  const auto& pending = decoded->rounds[1].matches[reported_.number - 1];
+  EXPECT_EQ(pending.id, reported_);
+  EXPECT_TRUE(pending.a_result.has_value());
+  EXPECT_FALSE(pending.committed.has_value());
+
+  // The restored tournament snapshots the same, bar its fresh seed.
+  auto restored = TournamentImpl::Restore(opts_, *decoded);
+  ASSERT_TRUE(restored.ok()) << restored.status();
+  TournamentSnapshot again = (*restored)->Snapshot();
+  again.seed = decoded->seed;
+  EXPECT_EQ(EncodeSnapshot(again), encoded_);
+}
+
+TEST_F(SnapshotTest, TruncatedIsDataLoss) {
+  for (size_t size = 0; size < encoded_.size(); ++size) {
+    auto decoded = DecodeSnapshot(encoded_.substr(0, size));
+    EXPECT_EQ(decoded.status().code(), absl::StatusCode::kDataLoss)
+        << "Cut to " << size << " of " << encoded_.size() << " bytes";
+  }
+}
+
+TEST_F(SnapshotTest, UnknownAvoidanceIsDataLoss) {
+  auto decoded = DecodeSnapshot(encoded_);
+  ASSERT_TRUE(decoded.ok()) << decoded.status();
+  decoded->players[0].avoidance[0].strength = static_cast<Avoidance>(2);
+  EXPECT_EQ(DecodeSnapshot(EncodeSnapshot(*decoded)).status().code(),
+            absl::StatusCode::kDataLoss);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tcgtc
@@ -27,4 +27,13 @@ bool operator<(const TieBreakInfo& l, const TieBreakInfo& r) {
   return FromTieBreakInfo(l) < FromTieBreakInfo(r);
 }
 
+bool operator==(const TieBreakKey& l, const TieBreakKey& r) {
+  return l.match_points == r.match_points && l.breakers == r.breakers;
+}
+
+bool operator<(const TieBreakKey& l, const TieBreakKey& r) {
+  if (l.match_points != r.match_points) return l.match_points < r.match_points;
+  return l.breakers < r.breakers;
+}
+
 }  // namespace tgctc
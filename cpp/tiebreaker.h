@@ -1,13 +1,15 @@
 #ifndef _TCGTC_TIEBREAKER_H_
 #define _TCGTC_TIEBREAKER_H_
 
+#include <array>
 #include <cstdint>
 
 #include "fraction.h"
 
 namespace tcgtc {
 
-// The MTR defined ordering of players.
+// A player's tie-breakers. The comparison operators give the MTR ordering; see
+// TieBreakPolicy for other rule sets.
 struct TieBreakInfo {
   uint16_t match_points = 0;
   Fraction opp_mwp;
@@ -18,6 +20,89 @@ bool operator==(const TieBreakInfo& l, const TieBreakInfo& r);
 bool operator!=(const TieBreakInfo& l, const TieBreakInfo& r);
 bool operator<(const TieBreakInfo& l, const TieBreakInfo& r);
 
+// The tie-breakers of a player, permuted into the order a rule set compares
+// them in. Sorting by key is then the same lexicographic comparison for every
+// rule set.
+struct TieBreakKey {
+  uint16_t match_points = 0;
+  std::array<Fraction, 3> breakers;
+};
+bool operator==(const TieBreakKey& l, const TieBreakKey& r);
+bool operator<(const TieBreakKey& l, const TieBreakKey& r);
+
+// The rule sets we run events under. Selected per tournament.
+enum class TieBreakRules : uint8_t {
+  // MTR: 1/3 floor, byes are not opponents, OMW% -> GW% -> OGW%.
+  kMtr = 0,
+  // 1/4 floor, a bye counts as an opponent at the floor, OMW% -> OGW% -> GW%.
+  kQuarterFloor,
+  // No floor, byes are not opponents, OMW% -> GW% -> OGW%.
+  kNoFloor,
+};
+
+enum class TieBreak : uint8_t { kOppMatchWin, kGameWin, kOppGameWin };
+
+enum class ByeHandling : uint8_t {
+  // A bye counts towards a player's own record only.
+  kExcluded,
+  // A bye also counts as an opponent with MW% and GW% at the floor.
+  kFloorOpponent,
+};
+
+// A rule set, as a compile-time policy, so that the standings computation is
+// specialized per rule set rather than branching on it per player.
+template <uint64_t FloorNumer, uint64_t FloorDenom, ByeHandling Byes,
+          TieBreak First, TieBreak Second, TieBreak Third>
+struct TieBreakPolicy {
+  static_assert(FloorDenom != 0, "Floor must be a valid fraction.");
+  static_assert(First != Second && Second != Third && First != Third,
+                "Each tie-breaker is compared exactly once.");
+
+  static constexpr ByeHandling kByes = Byes;
+
+  static const Fraction& Floor() {
+    static const Fraction kFloor(FloorNumer, FloorDenom);
+    return kFloor;
+  }
+
+  // Win percentages are never considered lower than the floor.
+  static Fraction Bound(const Fraction& f) {
+    return f < Floor() ? Floor() : f;
+  }
+
+  static TieBreakKey Key(const TieBreakInfo& info) {
+    return TieBreakKey{info.match_points,
+                       {Get<First>(info), Get<Second>(info), Get<Third>(info)}};
+  }
+
+ private:
+  template <TieBreak B>
+  static const Fraction& Get(const TieBreakInfo& info) {
+    if constexpr (B == TieBreak::kOppMatchWin) return info.opp_mwp;
+    if constexpr (B == TieBreak::kGameWin) return info.gwp;
+    if constexpr (B == TieBreak::kOppGameWin) return info.opp_gwp;
+  }
+};
+
+using MtrPolicy = TieBreakPolicy<1, 3, ByeHandling::kExcluded,
+    TieBreak::kOppMatchWin, TieBreak::kGameWin, TieBreak::kOppGameWin>;
+using QuarterFloorPolicy = TieBreakPolicy<1, 4, ByeHandling::kFloorOpponent,
+    TieBreak::kOppMatchWin, TieBreak::kOppGameWin, TieBreak::kGameWin>;
+using NoFloorPolicy = TieBreakPolicy<0, 1, ByeHandling::kExcluded,
+    TieBreak::kOppMatchWin, TieBreak::kGameWin, TieBreak::kOppGameWin>;
+
+// Calls fn(Policy{}) with the policy implementing `rules`. This is the only
+// place we branch on the rule set.
+template <typename Fn>
+auto WithTieBreakPolicy(TieBreakRules rules, Fn&& fn) {
+  switch (rules) {
+    case TieBreakRules::kQuarterFloor: return fn(QuarterFloorPolicy{});
+    case TieBreakRules::kNoFloor: return fn(NoFloorPolicy{});
+    case TieBreakRules::kMtr:
+    default: return fn(MtrPolicy{});
+  }
+}
+
 }  // namespace tcgtc
 
 #endif // _TCGTC_TIEBREAKER_H_
@@ -0,0 +1,86 @@
+// Holds eviction (see TournamentManager::EvictIdle) to never losing a change
+// made through a Get() which raced it.
+
+#include "cpp/impl/tournament-manager.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "cpp/impl/tournament.h"
+
+namespace tcgtc {
+namespace internal {
+namespace {
+
+constexpr TournamentManager::Id kId = 4901;
+// Enough that writing the tournament out leaves a window for a Get() to land
+// in.
+constexpr uint64_t kPlayers = 2000;
+constexpr size_t kEvictions = 50;
+
+absl::Status AddPlayer(TournamentImpl& t, uint64_t id) {
+  return t.AddPlayer({id, "First", absl::StrCat("Last", id), ""});
+}
+
+TEST(TournamentManagerTest, GetDuringEvictIdle) {
+  TournamentManager::Options opts;
+  opts.shards = 1;
+  opts.seed = 1;
+  opts.snapshot_dir = ::testing::TempDir();
+  opts.idle_timeout = absl::ZeroDuration();
+  TournamentManager manager(opts);
+  {
+    auto t = manager.Create(kId, TournamentImpl::Options());
+    ASSERT_TRUE(t.ok()) << t.status();
+    for (uint64_t id = 1; id <= kPlayers; ++id) {
+      ASSERT_TRUE(AddPlayer(**t, id).ok());
+    }
+  }
+
+  // One more player is added through each Get(), until the tournament has been
+  // evicted (and so reloaded) kEvictions times.
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> last{kPlayers};
+  std::thread adder([&manager, &stop, &last]() {
+    while (!stop) {
+      const uint64_t id = last + 1;
+      {
+        auto t = manager.Get(kId);
+        ASSERT_TRUE(t.ok()) << t.status();
+        auto out = AddPlayer(**t, id);
+        ASSERT_TRUE(out.ok()) << out;
+      }
+      last = id;
+      // Lets go for long enough that eviction gets a chance.
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  size_t evicted = 0;
+  const absl::Time deadline = absl::Now() + absl::Seconds(30);
+  while (evicted < kEvictions && absl::Now() < deadline) {
+    auto n = manager.EvictIdle(absl::Now() + absl::Seconds(1));
+    ASSERT_TRUE(n.ok()) << n.status();
+    evicted += *n;
+  }
+  stop = true;
+  adder.join();
+  EXPECT_EQ(evicted, kEvictions);
+
+  auto t = manager.Get(kId);
+  ASSERT_TRUE(t.ok()) << t.status();
+  for (uint64_t id = 1; id <= last; ++id) {
+    EXPECT_TRUE((*t)->GetPlayer(id).ok()) << "Lost player " << id;
+  }
+  EXPECT_TRUE(manager.Remove(kId).ok());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tcgtc
@@ -0,0 +1,105 @@
+#include "cpp/trace.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+
+namespace tcgtc {
+namespace {
+// Chrome traces are in microseconds. Formatted exactly, since a double would be
+// rounded to six digits.
+std::string Micros(std::chrono::nanoseconds d) {
+  const int64_t nanos = std::max<int64_t>(d.count(), 0);
+  return absl::StrCat(nanos / 1000, ".",
+                      absl::Dec(nanos % 1000, absl::kZeroPad3));
+}
+}  // namespace
+
+Tracer& Tracer::Global() {
+  static Tracer* tracer = new Tracer();
+  return *tracer;
+}
+
+class Tracer::LocalOwner {
+ public:
+  explicit LocalOwner(Tracer* tracer) : tracer_(tracer) {
+    absl::MutexLock l(&tracer_->mu_);
+    if (!tracer_->free_.empty()) {
+      buffer_ = std::move(tracer_->free_.back());
+      tracer_->free_.pop_back();
+    } else {
+      buffer_ = std::make_shared<ThreadBuffer>(tracer_->buffers_.size() + 1);
+      tracer_->buffers_.push_back(buffer_);
+    }
+  }
+  ~LocalOwner() {
+    absl::MutexLock l(&tracer_->mu_);
+    tracer_->free_.push_back(std::move(buffer_));
+  }
+
+  LocalOwner(const LocalOwner&) = delete;
+  LocalOwner& operator=(const LocalOwner&) = delete;
+
+  ThreadBuffer& buffer() { return *buffer_; }
+
+ private:
+  // Never destroyed (see Global), so outlives every thread.
+  Tracer* const tracer_;
+  std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+Tracer::ThreadBuffer& Tracer::Local() {
+  thread_local LocalOwner local(this);
+  return local.buffer();
+}
+
+void Tracer::Record(const Span& span) {
+  ThreadBuffer& buffer = Local();
+  // Only contended while the buffers are being dumped or cleared.
+  absl::MutexLock l(&buffer.mu);
+  if (buffer.spans.size() < kSpansPerThread) {
+    buffer.spans.push_back(span);
+  } else {
+    buffer.spans[buffer.next % kSpansPerThread] = span;
+  }
+  ++buffer.next;
+}
+
+std::string Tracer::ChromeTraceJson() const {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    absl::MutexLock l(&mu_);
+    buffers = buffers_;
+  }
+
+  std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& buffer : buffers) {
+    absl::MutexLock l(&buffer->mu);
+    for (const Span& span : buffer->spans) {
+      absl::StrAppend(&out, first ? "" : ",", "\n{\"name\":\"", span.name,
+                      "\",\"cat\":\"tcgtc\",\"ph\":\"X\",\"pid\":1,\"tid\":",
+                      buffer->tid, ",\"ts\":", Micros(span.start - epoch_),
+                      ",\"dur\":", Micros(span.duration), ",\"args\":{");
+      for (uint8_t i = 0; i < span.num_args; ++i) {
+        absl::StrAppend(&out, i == 0 ? "" : ",", "\"", span.args[i].first,
+                        "\":", span.args[i].second);
+      }
+      absl::StrAppend(&out, "}}");
+      first = false;
+    }
+  }
+  absl::StrAppend(&out, "\n]}\n");
+  return out;
+}
+
+void Tracer::Clear() {
+  absl::MutexLock l(&mu_);
+  for (const auto& buffer : buffers_) {
+    absl::MutexLock buffer_lock(&buffer->mu);
+    buffer->spans.clear();
+    buffer->next = 0;
+  }
+}
+
+}  // namespace tcgtc
@@ -0,0 +1,123 @@
+// Opt-in tracing of nested spans (a round's pairing, each score group, each
+// stage of the matching, ...), for seeing why one particular operation was
+// slow where the histograms in metrics.h only show that it was.
+//
+// Spans go into a ring buffer per thread, holding the most recent
+// kSpansPerThread, so tracing never blocks one thread on another. A thread's
+// buffer is handed on to the next thread to record once it exits, so memory is
+// bounded by the most threads ever recording at once, however long it runs and
+// however many threads come and go. Tracer::ChromeTraceJson() dumps every buffer in
+// the Chrome trace event format, which Perfetto (ui.perfetto.dev) and
+// chrome://tracing open directly: spans on a thread nest by time.
+//
+// Off by default, in which case a span costs one relaxed load.
+
+#ifndef _TCGTC_TRACE_H_
+#define _TCGTC_TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace tcgtc {
+
+class Tracer {
+ public:
+  static constexpr size_t kSpansPerThread = 1 << 14;
+  static constexpr size_t kMaxArgs = 3;
+
+  struct Span {
+    // Names and keys must outlive the tracer, e.g. string literals.
+    const char* name = nullptr;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds duration{0};
+    uint8_t num_args = 0;
+    std::array<std::pair<const char*, int64_t>, kMaxArgs> args;
+  };
+
+  static Tracer& Global();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void set_enabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+
+  // Adds a finished span to the calling thread's buffer, replacing its oldest
+  // span if full.
+  void Record(const Span& span);
+
+  // Every span retained, on every thread that has recorded one, as a Chrome
+  // trace (JSON object format).
+  std::string ChromeTraceJson() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Discards every span retained.
+  void Clear() ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t tid) : tid(tid) {}
+
+    const uint32_t tid;
+    absl::Mutex mu;
+    std::vector<Span> spans ABSL_GUARDED_BY(mu);
+    // Total spans recorded; the next goes at next % kSpansPerThread.
+    uint64_t next ABSL_GUARDED_BY(mu) = 0;
+  };
+
+  // Returns its thread's buffer to free_ on thread exit.
+  class LocalOwner;
+
+  Tracer() : epoch_(std::chrono::steady_clock::now()) {}
+  ThreadBuffer& Local() ABSL_LOCKS_EXCLUDED(mu_);
+
+  const std::chrono::steady_clock::time_point epoch_;
+  std::atomic<bool> enabled_{false};
+
+  mutable absl::Mutex mu_;
+  // Kept after their thread exits (e.g. a pool that was shut down), so that
+  // its spans are still dumped until the buffer is reused.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_ ABSL_GUARDED_BY(mu_);
+  // Buffers whose thread has exited, for the next new thread to record into.
+  // Their tid is kept, so one tid in a trace may be several threads in turn.
+  std::vector<std::shared_ptr<ThreadBuffer>> free_ ABSL_GUARDED_BY(mu_);
+};
+
+// Records a span from construction to destruction, if tracing was enabled at
+// construction.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name) {
+    if (!Tracer::Global().enabled()) return;
+    span_.name = name;
+    span_.start = std::chrono::steady_clock::now();
+  }
+  ~TraceSpan() {
+    if (span_.name == nullptr) return;
+    span_.duration = std::chrono::steady_clock::now() - span_.start;
+    Tracer::Global().Record(span_);
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  // Annotates the span, e.g. with the score group being paired. At most
+  // kMaxArgs are kept.
+  void AddArg(const char* key, int64_t value) {
+    if (span_.name == nullptr || span_.num_args == Tracer::kMaxArgs) return;
+    span_.args[span_.num_args++] = {key, value};
+  }
+
+ private:
+  Tracer::Span span_;
+};
+
+}  // namespace tcgtc
+
+#endif  // _TCGTC_TRACE_H_